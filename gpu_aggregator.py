@@ -0,0 +1,781 @@
+#!/usr/bin/env python3
+"""
+GPU Fleet Aggregator
+Collects from many node collectors (gpu_collector.py --aggregator ADDR)
+and answers fleet-wide questions such as "p99 temperature per rack over
+the last 5 minutes" without raw samples.
+
+Each node keeps a DDSketch (gpu_sketch.py) per GPU and metric for the
+current window (--sketch-window, default 60 s, aligned to wall-clock time
+so windows line up across nodes) and ships it when the window closes,
+batched with the window's samples. The aggregator merges every batch
+hierarchically as it arrives: GPUs into the node's sketch, the node's
+into one per value of each --group-by label (rack by default), and those
+into the fleet's. A quantile query merges the stored windows it covers at
+one level, so it costs the same on ten nodes as on ten thousand.
+
+Every reported GPU is also indexed by its labels (gpu_label_index.py), so
+selections such as "AMD GPUs on amdgpu in rack r12" are posting-list
+intersections instead of scans over every node.
+
+Node connection:  MSG_NODE_HELLO (JSON), then MSG_BATCH per window
+Query connection: MSG_QUERY (JSON) -> MSG_QUERY_RESULT (JSON)
+
+    python3 gpu_aggregator.py --listen 0.0.0.0:7070
+    python3 gpu_collector.py --serve --aggregator aggregator:7070 --node-label rack=r12
+    python3 gpu_aggregator.py --connect aggregator:7070 --query TEMPERATURE --by rack
+    python3 gpu_aggregator.py --connect aggregator:7070 --select 'vendor_id=0x1002,metric=TEMPERATURE'
+"""
+import argparse
+import errno
+import json
+import math
+import os
+import select
+import selectors
+import socket
+import struct
+import sys
+import time
+from collections import deque
+
+from gpu_collector_protocol import (
+    MSG_ERROR, MSG_NODE_HELLO, MSG_BATCH, MSG_QUERY, MSG_QUERY_RESULT,
+    FrameDecoder, encode_frame, encode_json, sample_struct,
+)
+from gpu_label_index import LabelIndex
+from gpu_sketch import DEFAULT_ALPHA, DDSketch
+
+DEFAULT_PORT = 7070
+SKETCH_WINDOW = 60.0
+KEEP_SECONDS = 3600.0
+DEFAULT_QUANTILES = [0.5, 0.9, 0.99]
+DEFAULT_SELECT_LIMIT = 1000
+
+# Series labels taken from each GPU of a node's schema
+GPU_LABELS = ('name', 'vendor_id', 'device_id', 'driver', 'pci_path')
+
+# window_start_ns (wall clock), window seconds, sample count, sketch count
+BATCH_HEADER = struct.Struct('<QfII')
+# gpu index, metric index, sketch byte length
+SKETCH_ENTRY = struct.Struct('<HHI')
+
+MAX_OUTPUT_BYTES = 4 * 1024 * 1024
+
+
+def parse_address(text):
+    """'host:port' or ':port' -> TCP address; anything with a slash -> Unix socket path"""
+    if '/' in text:
+        return socket.AF_UNIX, text
+    host, _, port = text.rpartition(':')
+    return socket.AF_INET, (host or '0.0.0.0', int(port or DEFAULT_PORT))
+
+
+def connect(address, timeout=None):
+    family, target = parse_address(address)
+    sock = socket.socket(family, socket.SOCK_STREAM)
+    sock.settimeout(timeout)
+    sock.connect(target)
+    return sock
+
+
+# ---------------------------------------------------------------------------
+# Node side
+# ---------------------------------------------------------------------------
+
+class AggregatorUplink:
+    """
+    Per-window sketches of one collector, shipped to the aggregator when
+    the window closes. add() costs one sketch insert per GPU and metric.
+    The socket is non-blocking: batches wait in a bounded queue and are
+    written as the aggregator accepts them, from the collector's selector
+    when attach()ed, else on each add(). A slow or lost aggregator costs
+    batches and a reconnect attempt at the next window, never a stalled
+    collector.
+    """
+    MAX_QUEUE = 16      # Batches waiting for the aggregator; the oldest are dropped
+
+    def __init__(self, address, node, labels, schema, window_seconds=SKETCH_WINDOW,
+                 alpha=DEFAULT_ALPHA):
+        self.address = address
+        self.node = node
+        self.labels = labels
+        self.schema = schema
+        self.window_ns = int(window_seconds * 1e9)
+        self.alpha = alpha
+        self.gpu_count = len(schema['gpus'])
+        self.metric_count = len(schema['metrics'])
+        self.format = sample_struct(self.gpu_count * self.metric_count)
+        self.realtime_offset_ns = time.time_ns() - time.monotonic_ns()
+
+        self.sock = None
+        self.target = None      # Resolved address, so reconnects do not resolve again
+        self.selector = None
+        self.writing = False
+        self.hello = None       # Frame being written before any batch
+        self.queue = deque()
+        self.current = b''
+        self.current_batch = False
+        self.offset = 0
+        self.error = None
+        self.window_start = None
+        self.samples = []
+        self.sketches = None
+        self.batches = 0
+        self.dropped = 0
+
+    def attach(self, selector):
+        """Flush from a selector loop; events call back with the key's data"""
+        self.selector = selector
+        if self.sock is not None:
+            selector.register(self.sock, self._events(), self._event)
+
+    def detach(self):
+        if self.selector is not None and self.sock is not None:
+            self.selector.unregister(self.sock)
+        self.selector = None
+
+    def _events(self):
+        return selectors.EVENT_READ | (selectors.EVENT_WRITE if self.writing else 0)
+
+    def _connect(self):
+        family, target = parse_address(self.address)
+        if family == socket.AF_INET and self.target is None:
+            host, port = target
+            self.target = socket.getaddrinfo(host, port, family, socket.SOCK_STREAM)[0][4]
+        sock = socket.socket(family, socket.SOCK_STREAM)
+        sock.setblocking(False)
+        err = sock.connect_ex(self.target or target)
+        if err not in (0, errno.EINPROGRESS):
+            sock.close()
+            raise OSError(err, os.strerror(err))
+        self.sock = sock
+        # Batches queued for the previous connection follow the new hello
+        self.hello = memoryview(encode_json(MSG_NODE_HELLO, {
+            'node': self.node, 'labels': self.labels, 'schema': self.schema,
+            'realtime_offset_ns': self.realtime_offset_ns,
+            'window_seconds': self.window_ns / 1e9,
+        }))
+        self.current = b''
+        self.writing = False
+        if self.selector is not None:
+            self.selector.register(sock, self._events(), self._event)
+
+    def add(self, sample):
+        if self.selector is None and self.writing:
+            self._flush()
+        realtime_ns = sample.timestamp_ns + self.realtime_offset_ns
+        start = realtime_ns - realtime_ns % self.window_ns
+        if start != self.window_start:
+            if self.window_start is not None:
+                self._ship()
+            self.window_start = start
+            self.samples = []
+            self.sketches = [DDSketch(self.alpha) for _ in range(len(sample.values))]
+
+        self.samples.append(self.format.pack(sample.seq, sample.timestamp_ns, *sample.values))
+        for sketch, value in zip(self.sketches, sample.values):
+            sketch.add(value)
+
+    def _ship(self):
+        payload = bytearray(BATCH_HEADER.pack(self.window_start, self.window_ns / 1e9,
+                                              len(self.samples), 0))
+        for sample in self.samples:
+            payload += sample
+        sketches = 0
+        for slot, sketch in enumerate(self.sketches):
+            if not sketch.count:
+                continue
+            data = sketch.to_bytes()
+            gpu, metric = divmod(slot, self.metric_count)
+            payload += SKETCH_ENTRY.pack(gpu, metric, len(data)) + data
+            sketches += 1
+        BATCH_HEADER.pack_into(payload, 0, self.window_start, self.window_ns / 1e9,
+                               len(self.samples), sketches)
+        if len(self.queue) >= self.MAX_QUEUE:
+            self.queue.popleft()
+            self.dropped += 1
+        self.queue.append(encode_frame(MSG_BATCH, bytes(payload)))
+        try:
+            if self.sock is None:
+                self._connect()
+        except OSError as e:
+            self._failed(e)
+            return
+        self._flush()
+
+    def _failed(self, error):
+        if self.error is None:
+            print(f"⚠️  Aggregator {self.address}: {error}", file=sys.stderr)
+        self.error = error
+        self._disconnect()
+
+    def _flush(self):
+        """Write as much as the socket accepts"""
+        while True:
+            if not self.current:
+                if self.hello is not None:
+                    self.current, self.hello = self.hello, None
+                    self.current_batch = False
+                elif self.queue:
+                    self.current = memoryview(self.queue.popleft())
+                    self.current_batch = True
+                else:
+                    break
+                self.offset = 0
+            try:
+                sent = self.sock.send(self.current[self.offset:])
+            except (BlockingIOError, InterruptedError):
+                break
+            except OSError as e:
+                self._failed(e)
+                return
+            self.offset += sent
+            if self.offset < len(self.current):
+                break
+            self.current = b''
+            self.batches += self.current_batch
+            self.error = None
+        writing = bool(self.current) or self.hello is not None or bool(self.queue)
+        if writing != self.writing:
+            self.writing = writing
+            if self.selector is not None:
+                self.selector.modify(self.sock, self._events(), self._event)
+
+    def _event(self, events):
+        if events & selectors.EVENT_READ:
+            # The aggregator only writes to report an error before closing
+            try:
+                data = self.sock.recv(65536)
+            except (BlockingIOError, InterruptedError):
+                data = None
+            except OSError as e:
+                self._failed(e)
+                return
+            if data == b'':
+                self._failed(OSError(errno.ECONNRESET, "aggregator closed the connection"))
+                return
+        if events & selectors.EVENT_WRITE and self.sock is not None:
+            self._flush()
+
+    def _disconnect(self):
+        if self.sock is not None:
+            if self.selector is not None:
+                self.selector.unregister(self.sock)
+            self.sock.close()
+        self.sock = None
+        self.hello = None
+        self.current = b''      # A partly written batch is lost with the connection
+        self.writing = False
+
+    def close(self, timeout=2.0):
+        """Ship the partial current window, wait up to timeout for the queue, then disconnect"""
+        if self.samples:
+            self._ship()
+            self.samples = []
+        deadline = time.monotonic() + timeout
+        while self.sock is not None and self.writing and time.monotonic() < deadline:
+            _, writable, _ = select.select([], [self.sock], [], max(0.0, deadline - time.monotonic()))
+            if writable:
+                self._flush()
+        self.detach()
+        self._disconnect()
+
+
+# ---------------------------------------------------------------------------
+# Aggregator side
+# ---------------------------------------------------------------------------
+
+class FleetNode:
+    """A connected (or previously seen) node collector"""
+
+    def __init__(self, hello):
+        self.name = str(hello['node'])
+        self.labels = {str(k): str(v) for k, v in (hello.get('labels') or {}).items()}
+        self.schema = hello['schema']
+        self.metrics = self.schema['metrics']
+        self.gpus = self.schema['gpus']
+        self.format = sample_struct(len(self.gpus) * len(self.metrics))
+        self.realtime_offset_ns = hello.get('realtime_offset_ns', 0)
+        self.latest = None      # (seq, timestamp_ns, values) of the newest sample
+        self.last_seen = time.time()
+        self.series = []        # Label index series id per GPU
+
+    def series_labels(self, gpu):
+        """Node labels plus the GPU's own, as in /proc/gpu_monitor"""
+        labels = dict(self.labels)
+        labels['node'] = self.name
+        labels['gpu'] = gpu['index']
+        for label in GPU_LABELS:
+            value = gpu.get(label)
+            if label in ('vendor_id', 'device_id') and isinstance(value, int):
+                value = f"0x{value:04x}"
+            if value is not None:
+                labels[label] = value
+        return labels
+
+
+class _Connection:
+    __slots__ = ('sock', 'decoder', 'output', 'node')
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.decoder = FrameDecoder()
+        self.output = bytearray()
+        self.node = None
+
+
+class FleetAggregator:
+    """Merges node batches per node, group label value and fleet, per window"""
+
+    def __init__(self, group_by=('rack',), keep_seconds=KEEP_SECONDS):
+        self.group_by = tuple(group_by)
+        self.keep_ns = int(keep_seconds * 1e9)
+        self.nodes = {}
+        self.index = LabelIndex()
+        self.series = {}        # series id -> (node, GPU index)
+        # window_start_ns -> {'window_ns': int, 'scopes': {scope: {metric: DDSketch}}}
+        self.windows = {}
+
+    def scopes(self, node):
+        """Levels a node's sketches are merged into, most specific first"""
+        levels = [('node', node.name)]
+        levels += [(label, node.labels[label]) for label in self.group_by if label in node.labels]
+        levels.append(('fleet', ''))
+        return levels
+
+    def hello(self, request):
+        if not isinstance(request, dict) or 'node' not in request or 'schema' not in request:
+            raise ValueError("hello needs node and schema")
+        node = FleetNode(request)
+        previous = self.nodes.get(node.name)
+        labels = [node.series_labels(gpu) for gpu in node.gpus]
+        if previous is not None and [self.index.labels.get(series_id) for series_id in previous.series] \
+                == [{k: str(v) for k, v in gpu.items()} for gpu in labels]:
+            node.series = previous.series  # Reconnect of the same node: keep its series
+        else:
+            if previous is not None:
+                for series_id in previous.series:
+                    self.index.remove(series_id)
+                    del self.series[series_id]
+            for gpu, gpu_labels in zip(node.gpus, labels):
+                series_id = self.index.add(gpu_labels)
+                self.series[series_id] = (node.name, gpu['index'])
+                node.series.append(series_id)
+        self.nodes[node.name] = node
+        return node
+
+    def ingest(self, node, payload):
+        """Fold one MSG_BATCH into the stored windows"""
+        start, window_seconds, sample_count, sketch_count = BATCH_HEADER.unpack_from(payload)
+        offset = BATCH_HEADER.size
+        size = node.format.size
+        if sample_count:
+            last = offset + (sample_count - 1) * size
+            fields = node.format.unpack_from(payload, last)
+            node.latest = (fields[0], fields[1], fields[2:])
+        offset += sample_count * size
+        node.last_seen = time.time()
+
+        # GPUs into per-metric node sketches, then those up the hierarchy
+        merged = {}
+        for _ in range(sketch_count):
+            gpu, metric, length = SKETCH_ENTRY.unpack_from(payload, offset)
+            offset += SKETCH_ENTRY.size
+            sketch, end = DDSketch.from_bytes(payload, offset)
+            if end != offset + length or metric >= len(node.metrics):
+                raise ValueError("malformed sketch in batch")
+            offset = end
+            name = node.metrics[metric]
+            if name in merged:
+                merged[name].merge(sketch)
+            else:
+                merged[name] = sketch
+
+        window = self.windows.get(start)
+        if window is None:
+            window = self.windows[start] = {'window_ns': int(round(window_seconds * 1e9)),
+                                            'scopes': {}}
+            self._expire(start)
+        for scope in self.scopes(node):
+            sketches = window['scopes'].setdefault(scope, {})
+            for name, sketch in merged.items():
+                if name in sketches:
+                    sketches[name].merge(sketch)
+                else:
+                    copy = DDSketch(sketch.alpha)
+                    copy.merge(sketch)
+                    sketches[name] = copy
+
+    def _expire(self, newest):
+        for start in [start for start in self.windows if start < newest - self.keep_ns]:
+            del self.windows[start]
+
+    def query(self, request):
+        """
+        {'metric', 'quantiles', 'seconds', 'scope': {'rack': 'r1'} or None,
+         'match': label selector or None, 'by': 'node' | node label | None}
+        -> quantiles per group
+        """
+        metric = request.get('metric')
+        if not isinstance(metric, str):
+            raise ValueError("query needs a metric")
+        quantiles = request.get('quantiles') or DEFAULT_QUANTILES
+        if not all(isinstance(q, (int, float)) and 0 <= q <= 1 for q in quantiles):
+            raise ValueError("quantiles must be within 0..1")
+        seconds = request.get('seconds', 300)
+        scope = request.get('scope') or {}
+        match = dict(request.get('match') or {})
+        by = request.get('by')
+        if len(scope) > 1:
+            raise ValueError("scope selects one level, e.g. {\"rack\": \"r12\"}")
+        if scope:
+            level, value = next(iter(scope.items()))
+            if level != 'node' and level not in self.group_by:
+                raise ValueError(f"unknown scope {level}")
+
+        if match or (scope and by is not None):
+            # Node sketches of the selected nodes, merged per group at query time
+            match.update(scope)
+            nodes = self._matching_nodes(match)
+            if by is None:
+                group_of = lambda node: ('fleet', '')
+            elif by == 'node':
+                group_of = lambda node: ('node', node.name)
+            else:
+                group_of = lambda node: (by, node.labels[by]) if by in node.labels else None
+            wanted = {}
+            for node in nodes:
+                group = group_of(node)
+                if group is not None:
+                    wanted[('node', node.name)] = group
+        else:
+            # A stored level: the fleet, one scope, or every group of a merged label
+            if by is not None and by != 'node' and by not in self.group_by:
+                raise ValueError(f"cannot group by {by} without a match; aggregating by node, "
+                                 + ', '.join(self.group_by))
+            if scope:
+                wanted = {(level, str(value)): (level, str(value))}
+            else:
+                wanted = None
+                level = by or 'fleet'
+
+        cutoff = time.time_ns() - int(seconds * 1e9)
+        groups = {}
+        windows = 0
+        for start, window in self.windows.items():
+            if start + window['window_ns'] <= cutoff:
+                continue
+            windows += 1
+            if wanted is None:
+                items = ((key, key, sketches) for key, sketches in window['scopes'].items()
+                         if key[0] == level)
+            else:
+                items = ((key, wanted[key], window['scopes'][key]) for key in wanted
+                         if key in window['scopes'])
+            for _key, group, sketches in items:
+                sketch = sketches.get(metric)
+                if sketch is None:
+                    continue
+                total = groups.get(group)
+                if total is None:
+                    total = groups[group] = DDSketch(sketch.alpha)
+                total.merge(sketch)
+
+        return {
+            'metric': metric, 'seconds': seconds, 'windows': windows,
+            'groups': [{'scope': {key[0]: key[1]} if key[0] != 'fleet' else {},
+                        'count': sketch.count,
+                        'quantiles': {str(q): sketch.quantile(q) for q in quantiles}}
+                       for key, sketch in sorted(groups.items())],
+        }
+
+    def _matching_nodes(self, match):
+        """
+        Nodes whose GPUs all match; sketches are kept per node, so a node
+        with only some GPUs matching (mixed vendors) cannot be split
+        """
+        matched = {}
+        for series_id in self.index.select(match):
+            name = self.series[series_id][0]
+            matched[name] = matched.get(name, 0) + 1
+        partial = [name for name, count in matched.items() if count != len(self.nodes[name].series)]
+        if partial:
+            raise ValueError(f"quantiles are kept per node, but only some GPUs of "
+                             f"{', '.join(sorted(partial)[:5])} match; use select for GPU level labels")
+        return [self.nodes[name] for name in matched]
+
+    def select(self, request):
+        """
+        {'select': label selector, 'limit'} -> matching series with their
+        newest shipped values; a 'metric' label picks the columns
+        """
+        selector = dict(request.get('select') or {})
+        limit = request.get('limit') or DEFAULT_SELECT_LIMIT
+        metrics = selector.pop('metric', None)
+        if isinstance(metrics, str):
+            metrics = [metrics]
+
+        started = time.perf_counter()
+        ids = self.index.select(selector)
+        lookup_us = (time.perf_counter() - started) * 1e6
+
+        series = []
+        for series_id in ids[:limit]:
+            name, gpu = self.series[series_id]
+            node = self.nodes[name]
+            width = len(node.metrics)
+            for column, metric in enumerate(node.metrics):
+                if metrics is not None and metric not in metrics:
+                    continue
+                value = None
+                if node.latest is not None:
+                    value = node.latest[2][gpu * width + column]
+                    value = None if math.isnan(value) else value
+                series.append({'id': series_id, 'labels': self.index.labels[series_id],
+                               'metric': metric, 'value': value,
+                               'timestamp_ns': node.latest[1] + node.realtime_offset_ns
+                               if node.latest is not None else None})
+        return {'select': request.get('select') or {}, 'matched': len(ids),
+                'lookup_us': lookup_us, 'series': series}
+
+
+class AggregatorServer:
+    """Single-threaded accept/read loop around a FleetAggregator"""
+
+    def __init__(self, aggregator, address):
+        self.aggregator = aggregator
+        self.address = address
+        self.selector = selectors.DefaultSelector()
+        family, target = parse_address(address)
+        if family == socket.AF_UNIX and os.path.exists(target):
+            os.unlink(target)
+        self.listener = socket.socket(family, socket.SOCK_STREAM)
+        if family == socket.AF_INET:
+            self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind(target)
+        self.listener.listen(256)
+        self.listener.setblocking(False)
+        self.selector.register(self.listener, selectors.EVENT_READ)
+
+    def _accept(self):
+        try:
+            sock, _ = self.listener.accept()
+        except (BlockingIOError, InterruptedError):
+            return
+        sock.setblocking(False)
+        self.selector.register(sock, selectors.EVENT_READ, _Connection(sock))
+
+    def _drop(self, conn):
+        self.selector.unregister(conn.sock)
+        conn.sock.close()
+
+    def _read(self, conn):
+        try:
+            data = conn.sock.recv(1024 * 1024)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            data = b''
+        if not data:
+            self._drop(conn)
+            return
+        conn.decoder.feed(data)
+        try:
+            for msg_type, _flags, payload in conn.decoder.frames():
+                self._handle(conn, msg_type, payload)
+        except (ValueError, KeyError, struct.error) as e:
+            conn.output += encode_json(MSG_ERROR, {'error': str(e)})
+        self._flush(conn)
+
+    def _handle(self, conn, msg_type, payload):
+        if msg_type == MSG_BATCH:
+            if conn.node is None:
+                raise ValueError("batch before hello")
+            self.aggregator.ingest(conn.node, payload)
+        elif msg_type == MSG_NODE_HELLO:
+            conn.node = self.aggregator.hello(json.loads(payload))
+            print(f"🖧  Node {conn.node.name} {conn.node.labels}: {len(conn.node.gpus)} GPU(s)",
+                  file=sys.stderr)
+        elif msg_type == MSG_QUERY:
+            request = json.loads(payload)
+            if not isinstance(request, dict):
+                raise ValueError("query must be a JSON object")
+            if 'select' in request:
+                result = self.aggregator.select(request)
+            else:
+                result = self.aggregator.query(request)
+            conn.output += encode_json(MSG_QUERY_RESULT, result)
+        else:
+            raise ValueError(f"unknown message type {msg_type}")
+
+    def _flush(self, conn):
+        if conn.output:
+            try:
+                sent = conn.sock.send(conn.output)
+                del conn.output[:sent]
+            except (BlockingIOError, InterruptedError):
+                pass
+            except OSError:
+                self._drop(conn)
+                return
+            if len(conn.output) > MAX_OUTPUT_BYTES:
+                self._drop(conn)  # Client stopped reading its results
+                return
+        events = selectors.EVENT_READ | (selectors.EVENT_WRITE if conn.output else 0)
+        self.selector.modify(conn.sock, events, conn)
+
+    def serve_forever(self):
+        while True:
+            for key, events in self.selector.select():
+                if key.fileobj is self.listener:
+                    self._accept()
+                    continue
+                conn = key.data
+                if events & selectors.EVENT_READ:
+                    self._read(conn)
+                if events & selectors.EVENT_WRITE and conn.sock.fileno() >= 0:
+                    self._flush(conn)
+
+    def close(self):
+        for key in list(self.selector.get_map().values()):
+            if key.fileobj is not self.listener:
+                self._drop(key.data)
+        self.selector.close()
+        self.listener.close()
+
+
+class AggregatorClient:
+    """Blocking query client"""
+
+    def __init__(self, address, timeout=10):
+        self.sock = connect(address, timeout)
+        self.decoder = FrameDecoder()
+
+    def _reply(self):
+        while True:
+            for msg_type, _flags, payload in self.decoder.frames():
+                if msg_type == MSG_ERROR:
+                    raise RuntimeError(json.loads(payload).get('error', 'aggregator error'))
+                return msg_type, payload
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("aggregator closed the connection")
+            self.decoder.feed(data)
+
+    def query(self, metric, quantiles=None, seconds=300, scope=None, by=None, match=None):
+        """Quantiles of a metric over the last seconds, fleet-wide or per group"""
+        self.sock.sendall(encode_json(MSG_QUERY, {
+            'metric': metric, 'quantiles': quantiles, 'seconds': seconds,
+            'scope': scope, 'by': by, 'match': match}))
+        _msg_type, payload = self._reply()
+        return json.loads(payload)
+
+    def select(self, selector, limit=None):
+        """Series matching a label selector, e.g. {'rack': 'r12', 'driver': ['amdgpu', 'i915']}"""
+        self.sock.sendall(encode_json(MSG_QUERY, {'select': selector, 'limit': limit}))
+        _msg_type, payload = self._reply()
+        return json.loads(payload)
+
+    def close(self):
+        self.sock.close()
+
+
+def format_result(result):
+    lines = [f"📊 {result['metric']} over {result['seconds']:g}s ({result['windows']} window(s))"]
+    for group in result['groups']:
+        name = ', '.join(f"{k}={v}" for k, v in group['scope'].items()) or 'fleet'
+        values = '  '.join(f"p{float(q) * 100:g}={v:.1f}" if v is not None else f"p{float(q) * 100:g}=—"
+                           for q, v in group['quantiles'].items())
+        lines.append(f"   {name:<24} n={group['count']:<8} {values}")
+    return '\n'.join(lines)
+
+
+def format_selection(result):
+    shown = len({series['id'] for series in result['series']})
+    lines = [f"🏷️  {result['matched']} GPU(s) matched in {result['lookup_us']:.0f} µs"
+             + (f", first {shown} shown" if shown < result['matched'] else "")]
+    for series in result['series']:
+        labels = series['labels']
+        value = f"{series['value']:.2f}" if series['value'] is not None else "—"
+        lines.append(f"   {labels['node']:<16} GPU {labels['gpu']:<3} {labels.get('name', ''):<32} "
+                     f"{series['metric']:<20} {value}")
+    return '\n'.join(lines)
+
+
+def parse_selector(text):
+    """'rack=r12,driver=amdgpu|i915' -> {'rack': 'r12', 'driver': ['amdgpu', 'i915']}"""
+    selector = {}
+    for term in filter(None, (term.strip() for term in text.split(','))):
+        label, sep, value = term.partition('=')
+        if not sep:
+            raise ValueError(f"expected LABEL=VALUE, got '{term}'")
+        selector[label.strip()] = value.split('|') if '|' in value else value
+    return selector
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="GPU fleet aggregator")
+    parser.add_argument('--listen', default=None, metavar='ADDR',
+                        help=f"serve node collectors and queries on host:port or a socket path "
+                             f"(e.g. :{DEFAULT_PORT})")
+    parser.add_argument('--group-by', action='append', default=None, metavar='LABEL',
+                        help="node label merged as a level between node and fleet (default: rack)")
+    parser.add_argument('--keep', type=float, default=KEEP_SECONDS, help="seconds of windows kept")
+    parser.add_argument('--connect', default=None, metavar='ADDR', help="aggregator to query")
+    parser.add_argument('--query', default=None, metavar='METRIC', help="metric to query")
+    parser.add_argument('--quantile', type=float, action='append', default=None,
+                        help="quantile (0..1), repeatable; default 0.5, 0.9, 0.99")
+    parser.add_argument('--seconds', type=float, default=300, help="query the last N seconds")
+    parser.add_argument('--by', default=None, help="per node or per group label")
+    parser.add_argument('--scope', default=None, metavar='LABEL=VALUE',
+                        help="restrict to one node (node=NAME) or group (rack=r12)")
+    parser.add_argument('--match', default=None, metavar='SELECTOR',
+                        help="restrict a query to nodes matching labels, e.g. 'zone=eu,driver=amdgpu'")
+    parser.add_argument('--select', default=None, metavar='SELECTOR',
+                        help="list GPUs matching labels with their latest values, "
+                             "e.g. 'vendor_id=0x1002,metric=TEMPERATURE' ('|' for alternatives)")
+    parser.add_argument('--limit', type=int, default=DEFAULT_SELECT_LIMIT,
+                        help="GPUs listed by --select")
+    parser.add_argument('--json', action='store_true')
+    args = parser.parse_args()
+
+    if args.query or args.select is not None:
+        scope = None
+        if args.scope:
+            label, _, value = args.scope.partition('=')
+            scope = {label: value}
+        try:
+            client = AggregatorClient(args.connect or f"127.0.0.1:{DEFAULT_PORT}")
+            if args.select is not None:
+                result = client.select(parse_selector(args.select), args.limit)
+            else:
+                result = client.query(args.query, args.quantile, args.seconds, scope, args.by,
+                                      parse_selector(args.match) if args.match else None)
+            client.close()
+        except (OSError, RuntimeError, ConnectionError, ValueError) as e:
+            print(f"❌ {e}", file=sys.stderr)
+            sys.exit(1)
+        if args.json:
+            print(json.dumps(result, indent=2))
+        else:
+            print(format_selection(result) if args.select is not None else format_result(result))
+        return
+
+    if not args.listen:
+        parser.error("use --listen ADDR to aggregate, or --query METRIC / --select to ask an aggregator")
+    aggregator = FleetAggregator(args.group_by or ['rack'], args.keep)
+    server = AggregatorServer(aggregator, args.listen)
+    print(f"🛰️  Aggregating on {args.listen}, levels: node, "
+          f"{', '.join(aggregator.group_by)}, fleet", file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        print("\n🛑 Aggregator stopped by user", file=sys.stderr)
+    finally:
+        server.close()
+
+
+if __name__ == "__main__":
+    main()
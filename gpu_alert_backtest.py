@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""
+GPU Alert Backtest
+Runs alert rules over recorded sessions (gpu_collector.py --record) to show
+when each rule would have fired, so thresholds can be tuned on real history
+instead of live. The recording is loaded into one float32 matrix; each
+(rule, GPU) pair is then evaluated over its whole column with numpy and
+the pairs are spread over a thread pool (numpy releases the GIL), so a
+session is processed at millions of rule evaluations per GPU-sample per second.
+
+Results match AlertEngine in the collector: same rule syntax, "for"
+durations measured in sample timestamps, anomaly baselines over the
+preceding window, resolution at the first sample where the condition no
+longer holds.
+
+    python3 gpu_alert_backtest.py session.gpurec --alert-file alert_rules.conf
+    python3 gpu_alert_backtest.py session.gpurec --alert 'HOT = TEMPERATURE > 80 for 30s'
+"""
+import argparse
+import json
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+from gpu_alerts import MIN_BASELINE_SAMPLES, load_rules
+from gpu_collector_protocol import sample_struct
+from gpu_recording import RecordingReader
+
+NUMPY_COMPARISONS = {'>': np.greater, '>=': np.greater_equal,
+                     '<': np.less, '<=': np.less_equal}
+
+
+def load_recording(path):
+    """(reader schema, timestamps int64[n], values float32[n, gpus * metrics])"""
+    reader = RecordingReader(path)
+    try:
+        data = b''.join(reader.sample_payloads())
+    finally:
+        reader.close()
+
+    columns = len(reader.gpus) * len(reader.metrics)
+    record = np.dtype([('seq', '<u8'), ('timestamp_ns', '<u8'), ('values', '<f4', (columns,))])
+    assert record.itemsize == sample_struct(columns).size
+    samples = np.frombuffer(data, dtype=record)
+    return reader.schema, samples['timestamp_ns'].astype(np.int64), samples['values']
+
+
+def vectorize(node, values, base):
+    """Evaluate a folded expression tree over whole columns"""
+    kind = node[0]
+    if kind == 'num':
+        return node[1]
+    if kind == 'slot':
+        return values[:, base + node[1]].astype(np.float64)
+    if kind == 'neg':
+        return -vectorize(node[1], values, base)
+    if kind == 'bin':
+        left = vectorize(node[2], values, base)
+        right = vectorize(node[3], values, base)
+        if node[1] == '+':
+            return left + right
+        if node[1] == '-':
+            return left - right
+        if node[1] == '*':
+            return left * right
+        right = np.asarray(right, dtype=np.float64)
+        return np.where(right != 0, left / np.where(right != 0, right, 1.0), np.nan)
+    args = [vectorize(arg, values, base) for arg in node[2]]
+    name = node[1]
+    if name == 'min':
+        return _reduce(np.minimum, args)
+    if name == 'max':
+        return _reduce(np.maximum, args)
+    if name == 'sum':
+        return _reduce(np.add, args)
+    if name == 'avg':
+        return _reduce(np.add, args) / len(args)
+    if name == 'abs':
+        return np.abs(args[0])
+    return np.minimum(np.maximum(args[0], args[1]), args[2])  # clamp
+
+
+def _reduce(fn, args):
+    result = args[0]
+    for arg in args[1:]:
+        result = fn(result, arg)
+    return result
+
+
+def deviates(rule, timestamps, series):
+    """Anomaly condition per sample, from prefix sums over the baseline windows"""
+    valid = ~np.isnan(series)
+    clean = np.where(valid, series, 0.0)
+    total = np.concatenate(([0.0], np.cumsum(clean)))
+    squares = np.concatenate(([0.0], np.cumsum(clean * clean)))
+    counts = np.concatenate(([0], np.cumsum(valid)))
+
+    index = np.arange(len(series))
+    start = np.searchsorted(timestamps, timestamps - rule.baseline_ns, 'left')
+    count = counts[index] - counts[start]
+    enough = count >= MIN_BASELINE_SAMPLES
+    safe = np.maximum(count, 1)
+    mean = (total[index] - total[start]) / safe
+    variance = np.maximum((squares[index] - squares[start]) / safe - mean * mean, 0.0)
+    return enough & valid & (np.abs(series - mean) > rule.sigmas * np.sqrt(variance))
+
+
+def backtest(rule, gpu, timestamps, values, metric_count):
+    """[(fired_ns, resolved_ns or None, value at firing)] of one rule on one GPU"""
+    series = vectorize(rule.node, values, gpu * metric_count)
+    series = np.broadcast_to(np.asarray(series, dtype=np.float64), timestamps.shape)
+    with np.errstate(invalid='ignore'):
+        if rule.anomaly:
+            active = deviates(rule, timestamps, series)
+        else:
+            active = NUMPY_COMPARISONS[rule.op](series, rule.threshold)
+
+    # Runs of consecutive samples where the condition holds
+    edges = np.diff(np.concatenate(([0], active.astype(np.int8), [0])))
+    starts = np.flatnonzero(edges == 1)
+    ends = np.flatnonzero(edges == -1)
+    fires = np.maximum(np.searchsorted(timestamps, timestamps[starts] + rule.for_ns, 'left'), starts)
+    held = fires < ends
+
+    count = len(timestamps)
+    return [(int(timestamps[fire]), int(timestamps[end]) if end < count else None,
+             float(series[fire]))
+            for fire, end in zip(fires[held], ends[held])]
+
+
+def run_backtest(path, rules_text, threads=None):
+    """Backtest every rule on every GPU of one recording"""
+    schema, timestamps, values = load_recording(path)
+    metrics = schema['metrics']
+    rules = load_rules(rules_text, metrics)
+    gpu_count = len(schema['gpus'])
+
+    started = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=threads or os.cpu_count()) as pool:
+        jobs = {(rule.name, gpu): pool.submit(backtest, rule, gpu, timestamps, values, len(metrics))
+                for rule in rules for gpu in range(gpu_count)}
+        results = {key: job.result() for key, job in jobs.items()}
+    elapsed = time.perf_counter() - started
+
+    return {
+        'recording': path,
+        'samples': len(timestamps),
+        'gpus': gpu_count,
+        'rules': [{'name': rule.name, 'condition': rule.text} for rule in rules],
+        'realtime_offset_ns': schema.get('realtime_offset_ns', 0),
+        'seconds': elapsed,
+        'evaluations_per_second': len(timestamps) * gpu_count * len(rules) / elapsed if elapsed else None,
+        'alerts': [{'rule': name, 'gpu': gpu, 'fired_ns': fired, 'resolved_ns': resolved,
+                    'value': value}
+                   for (name, gpu), events in results.items()
+                   for fired, resolved, value in events],
+    }
+
+
+def format_results(result):
+    """Per-rule summary and alert timeline"""
+    offset = result['realtime_offset_ns']
+
+    def clock(ns):
+        return time.strftime('%Y-%m-%d %H:%M:%S', time.localtime((ns + offset) / 1e9))
+
+    lines = [f"📼 {result['recording']}: {result['samples']} samples x {result['gpus']} GPU(s), "
+             f"{result['seconds'] * 1000:.1f} ms"
+             + (f" ({result['evaluations_per_second'] / 1e6:.1f}M rule evaluations/s)"
+                if result['evaluations_per_second'] else "")]
+    for rule in result['rules']:
+        alerts = sorted((alert for alert in result['alerts'] if alert['rule'] == rule['name']),
+                        key=lambda alert: alert['fired_ns'])
+        firing_ns = sum(((alert['resolved_ns'] or alert['fired_ns']) - alert['fired_ns'])
+                        for alert in alerts)
+        lines.append("")
+        lines.append(f"🚨 {rule['name']} = {rule['condition']}: {len(alerts)} alert(s), "
+                     f"{firing_ns / 60e9:.1f} min firing")
+        for alert in alerts:
+            resolved = (f"resolved after {(alert['resolved_ns'] - alert['fired_ns']) / 1e9:.0f}s"
+                        if alert['resolved_ns'] is not None else "still firing at end")
+            lines.append(f"   {clock(alert['fired_ns'])}  GPU {alert['gpu']}  "
+                         f"value {alert['value']:.2f}  {resolved}")
+    return '\n'.join(lines)
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="Backtest alert rules on recordings")
+    parser.add_argument('recordings', nargs='+', help="session files from gpu_collector.py --record")
+    parser.add_argument('--alert', action='append', default=[], metavar='NAME=CONDITION',
+                        help="rule, e.g. 'HOT = TEMPERATURE > 80 for 30s'")
+    parser.add_argument('--alert-file', default=None, metavar='FILE',
+                        help="file of alert rules, one per line")
+    parser.add_argument('--threads', type=int, default=None, help="worker threads (default: CPUs)")
+    parser.add_argument('--json', action='store_true', help="print results as JSON")
+    args = parser.parse_args()
+
+    rules_text = list(args.alert)
+    try:
+        if args.alert_file:
+            with open(args.alert_file) as f:
+                rules_text = f.read().splitlines() + rules_text
+    except OSError as e:
+        print(f"❌ {e}", file=sys.stderr)
+        sys.exit(1)
+    if not rules_text:
+        parser.error("no rules: use --alert or --alert-file")
+
+    results = []
+    for path in args.recordings:
+        try:
+            results.append(run_backtest(path, rules_text, args.threads))
+        except (OSError, ValueError) as e:  # ExpressionError is a ValueError
+            print(f"❌ {path}: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    if args.json:
+        print(json.dumps(results, indent=2))
+    else:
+        print('\n\n'.join(format_results(result) for result in results))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""
+GPU Alert Rules
+Per-GPU alert conditions evaluated by the collector on every sample, and
+by gpu_alert_backtest.py over recordings. A rule is
+
+    NAME = EXPRESSION OP NUMBER [for DURATION]
+    NAME = EXPRESSION deviates SIGMAS [over DURATION] [for DURATION]
+
+where EXPRESSION is a derived-metric expression (gpu_derived_metrics.py)
+over the collector's metrics, OP one of > >= < <=, and DURATION e.g. 30s,
+5m or 1h. The second form is an anomaly rule: the value is more than
+SIGMAS standard deviations from its mean over the preceding window
+(default 5m, at least MIN_BASELINE_SAMPLES samples).
+
+A rule fires once its condition has held for the "for" duration on a GPU
+and resolves at the first sample where it no longer holds; a missing value
+(NaN) does not hold. Transitions go to on_transition(rule, gpu, value,
+state, timestamp_ns) with state 'firing' or 'resolved'.
+"""
+import math
+import operator
+import re
+from collections import deque
+
+from gpu_derived_metrics import DerivedMetrics, ExpressionError
+
+COMPARISONS = {'>': operator.gt, '>=': operator.ge, '<': operator.lt, '<=': operator.le}
+
+DEFAULT_BASELINE = 300.0
+MIN_BASELINE_SAMPLES = 10
+
+_NUMBER = r'-?\d+(?:\.\d+)?(?:[eE][-+]?\d+)?'
+_THRESHOLD_RULE = re.compile(rf'^(.*?)\s*(>=|<=|>|<)\s*({_NUMBER})\s*(?:\bfor\s+(\S+))?$')
+_ANOMALY_RULE = re.compile(rf'^(.*?)\s+deviates\s+({_NUMBER})\s*(?:\bover\s+(\S+))?\s*'
+                           rf'(?:\bfor\s+(\S+))?$')
+_DURATION = re.compile(r'^(\d+(?:\.\d+)?)(ms|s|m|h)?$')
+_DURATION_UNITS = {'ms': 1e-3, 's': 1.0, 'm': 60.0, 'h': 3600.0, None: 1.0}
+_NAME = re.compile(r'^[A-Z][A-Z0-9_]*$')
+
+
+def parse_duration(text):
+    """'30s', '5m', '1h', '250ms' or plain seconds -> seconds"""
+    match = _DURATION.match(text.strip())
+    if not match:
+        raise ExpressionError(f"bad duration '{text}' (expected e.g. 30s, 5m)")
+    return float(match.group(1)) * _DURATION_UNITS[match.group(2)]
+
+
+class AlertRule:
+    """A parsed rule: the compiled expression and how its value is judged"""
+
+    def __init__(self, name, text, expression, node, evaluate, for_seconds,
+                 op=None, threshold=None, sigmas=None, baseline_seconds=None):
+        self.name = name
+        self.text = text
+        self.expression = expression
+        self.node = node            # Folded tree, for vectorized evaluation
+        self.evaluate = evaluate    # fn(values, base) -> float
+        self.for_ns = int(for_seconds * 1e9)
+        self.op = op
+        self.threshold = threshold
+        self.sigmas = sigmas
+        self.baseline_ns = int(baseline_seconds * 1e9) if baseline_seconds else 0
+
+    @property
+    def anomaly(self):
+        return self.sigmas is not None
+
+
+def parse_rule(name, text, metrics):
+    """Compile 'NAME = condition' against the given metric list"""
+    name = name.strip()
+    text = text.strip()
+    if not _NAME.match(name):
+        raise ExpressionError(f"alert rule names are upper case: '{name}'")
+
+    compiler = DerivedMetrics(metrics)
+    match = _ANOMALY_RULE.match(text)
+    if match:
+        expression, sigmas, over, hold = match.groups()
+        node, _inputs = compiler.parse(expression)
+        return AlertRule(name, text, expression, node, compiler.compile(node),
+                         parse_duration(hold) if hold else 0.0, sigmas=float(sigmas),
+                         baseline_seconds=parse_duration(over) if over else DEFAULT_BASELINE)
+    match = _THRESHOLD_RULE.match(text)
+    if match:
+        expression, op, threshold, hold = match.groups()
+        node, _inputs = compiler.parse(expression)
+        return AlertRule(name, text, expression, node, compiler.compile(node),
+                         parse_duration(hold) if hold else 0.0, op=op, threshold=float(threshold))
+    raise ExpressionError(f"{name}: expected 'EXPR > NUMBER [for 30s]' or "
+                          f"'EXPR deviates SIGMAS [over 5m] [for 30s]'")
+
+
+def load_rules(lines, metrics):
+    """'NAME = condition' lines; blank lines and # comments are skipped"""
+    rules = []
+    for number, line in enumerate(lines, 1):
+        line = line.split('#', 1)[0].strip()
+        if not line:
+            continue
+        name, sep, text = line.partition('=')
+        if not sep:
+            raise ExpressionError(f"line {number}: expected NAME = condition")
+        if any(rule.name == name.strip() for rule in rules):
+            raise ExpressionError(f"line {number}: {name.strip()} is already defined")
+        rules.append(parse_rule(name, text, metrics))
+    return rules
+
+
+class _Baseline:
+    """Running mean/variance of one GPU's values over the preceding window"""
+    __slots__ = ('window', 'total', 'squares')
+
+    def __init__(self):
+        self.window = deque()
+        self.total = 0.0
+        self.squares = 0.0
+
+    def deviates(self, timestamp_ns, value, rule):
+        window = self.window
+        start = timestamp_ns - rule.baseline_ns
+        while window and window[0][0] < start:
+            _, old = window.popleft()
+            self.total -= old
+            self.squares -= old * old
+
+        active = False
+        count = len(window)
+        if count >= MIN_BASELINE_SAMPLES and value == value:
+            mean = self.total / count
+            std = math.sqrt(max(self.squares / count - mean * mean, 0.0))
+            active = abs(value - mean) > rule.sigmas * std
+        if value == value:
+            window.append((timestamp_ns, value))
+            self.total += value
+            self.squares += value * value
+        return active
+
+
+class AlertEngine:
+    """Evaluates every rule for every GPU per sample"""
+
+    def __init__(self, rules, gpu_count, metric_count, on_transition=None):
+        self.rules = rules
+        self.gpu_count = gpu_count
+        self.metric_count = metric_count
+        self.on_transition = on_transition
+        self.pending = [[None] * gpu_count for _ in rules]   # Start of the condition run
+        self.firing = [[False] * gpu_count for _ in rules]
+        self.baselines = [[_Baseline() for _ in range(gpu_count)] if rule.anomaly else None
+                          for rule in rules]
+
+    def evaluate(self, timestamp_ns, values):
+        width = self.metric_count
+        for r, rule in enumerate(self.rules):
+            pending = self.pending[r]
+            firing = self.firing[r]
+            baselines = self.baselines[r]
+            compare = COMPARISONS.get(rule.op)
+            for gpu in range(self.gpu_count):
+                try:
+                    value = rule.evaluate(values, gpu * width)
+                except (OverflowError, ValueError, ZeroDivisionError):
+                    value = math.nan
+                if baselines is not None:
+                    active = baselines[gpu].deviates(timestamp_ns, value, rule)
+                else:
+                    active = compare(value, rule.threshold)  # False for NaN
+
+                if active:
+                    if pending[gpu] is None:
+                        pending[gpu] = timestamp_ns
+                    if not firing[gpu] and timestamp_ns - pending[gpu] >= rule.for_ns:
+                        firing[gpu] = True
+                        self._transition(rule, gpu, value, 'firing', timestamp_ns)
+                else:
+                    pending[gpu] = None
+                    if firing[gpu]:
+                        firing[gpu] = False
+                        self._transition(rule, gpu, value, 'resolved', timestamp_ns)
+
+    def _transition(self, rule, gpu, value, state, timestamp_ns):
+        if self.on_transition is not None:
+            self.on_transition(rule, gpu, value, state, timestamp_ns)
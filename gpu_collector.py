@@ -0,0 +1,1288 @@
+#!/usr/bin/env python3
+"""
+GPU Telemetry Collector
+Userspace sampler that reads GPU sysfs attributes directly.
+Every attribute of every GPU is opened once; each sampling epoch submits
+all reads to io_uring as a single batch (falls back to pread when
+io_uring is unavailable). NVIDIA GPUs are sampled through NVML when it is
+present, and Intel integrated GPUs get DRAM bandwidth from the uncore IMC
+counters. With --serve, one acquisition is fanned out to clients on a
+Unix socket, each with its own GPU/metric selection and rate, and with
+--http to browsers through the web dashboard. The GPUs' PCI/NUMA topology
+is built at discovery, rebuilt on hotplug and served on request.
+"""
+import argparse
+import ctypes
+import errno
+import json
+import math
+import mmap
+import os
+import selectors
+import signal
+import socket
+import sys
+import time
+from array import array
+from collections import deque
+
+from gpu_collector_protocol import (
+    PROTOCOL_VERSION, MSG_SCHEMA, MSG_SUBSCRIBED, MSG_SAMPLE, MSG_DROPPED,
+    MSG_ERROR, MSG_BACKFILL, MSG_SUBSCRIBE, MSG_ANNOTATE, MSG_TOPOLOGY,
+    MSG_GET_TOPOLOGY, MSG_IDLE, MSG_GET_IDLE, MSG_ALERT, POLICY_DROP_OLDEST,
+    POLICY_COALESCE, POLICIES, BACKFILL_HEADER, FrameDecoder, default_socket_path,
+    encode_frame, encode_json, sample_struct,
+)
+from gpu_derived_metrics import DerivedMetrics, ExpressionError
+from gpu_alerts import AlertEngine, load_rules
+from gpu_recording import Recorder
+from gpu_collector_plugins import PluginError, load_plugins
+from gpu_columnar_export import ColumnarRecorder, columnar_format
+from gpu_web_dashboard import WebDashboard
+from gpu_nvml import NVML_METRICS, NVMLError, load_nvml
+from gpu_uncore import UNCORE_METRICS, UncoreError, load_uncore
+from gpu_sysfs_sources import HotplugMonitor
+from gpu_topology import build_topology, format_matrix
+from gpu_aggregator import SKETCH_WINDOW, AggregatorUplink
+from gpu_idle import (
+    IDLE_MINUTES, IDLE_RULE, IDLE_UTILIZATION, IDLE_WINDOW, IdleTracker, format_report,
+)
+
+SYSFS_ROOT = '/sys'
+
+# PCI display classes (class >> 8)
+PCI_CLASS_VGA = 0x0300
+PCI_CLASS_3D = 0x0302
+
+# GPU vendor IDs
+PCI_VENDOR_ID_NVIDIA = 0x10de
+PCI_VENDOR_ID_AMD = 0x1002
+PCI_VENDOR_ID_INTEL = 0x8086
+
+VENDOR_NAMES = {
+    PCI_VENDOR_ID_NVIDIA: ('NVIDIA', 'nvidia'),
+    PCI_VENDOR_ID_AMD: ('AMD', 'amdgpu'),
+    PCI_VENDOR_ID_INTEL: ('Intel', 'i915'),
+}
+
+# Metric names match the per-GPU keys of /proc/gpu_monitor
+METRICS = ['MEMORY_USED', 'MEMORY_TOTAL', 'TEMPERATURE', 'CLOCK_MHZ',
+           'POWER_WATTS', 'UTILIZATION', 'FAN_RPM']
+
+def native_metrics(nvml=None, plugins=(), uncore=None):
+    """Metrics before derived ones: sysfs, NVML-only, uncore, then plugin metrics"""
+    native = list(METRICS)
+    if nvml is not None:
+        native += NVML_METRICS
+    if uncore is not None:
+        native += uncore.metrics
+    for plugin in plugins:
+        native += plugin.metrics
+    return native
+
+# Uevents that can change the topology: devices, links and driver bindings
+TOPOLOGY_SUBSYSTEMS = (b'SUBSYSTEM=pci', b'SUBSYSTEM=drm')
+
+# Same as MAX_BUFFER_SIZE in the kernel module
+ATTR_BUFFER_SIZE = 256
+
+MIB = 1024 * 1024
+
+# Sysfs attributes per vendor, mirroring read_*_data() in gpu_info_viewer.c:
+# (metric, base directory, candidate files, scale). The first candidate
+# that exists is used.
+HWMON_ATTRIBUTES = [
+    ('TEMPERATURE', 'hwmon', ['temp1_input'], 0.001),
+    ('POWER_WATTS', 'hwmon', ['power1_average', 'power1_input'], 1e-6),
+    ('FAN_RPM', 'hwmon', ['fan1_input'], 1),
+]
+
+ATTRIBUTE_TABLE = {
+    PCI_VENDOR_ID_NVIDIA: HWMON_ATTRIBUTES,
+    PCI_VENDOR_ID_AMD: HWMON_ATTRIBUTES + [
+        ('MEMORY_USED', 'device', ['mem_info_vram_used'], 1.0 / MIB),
+        ('MEMORY_TOTAL', 'device', ['mem_info_vram_total'], 1.0 / MIB),
+        ('UTILIZATION', 'device', ['gpu_busy_percent'], 1),
+    ],
+    PCI_VENDOR_ID_INTEL: HWMON_ATTRIBUTES + [
+        ('CLOCK_MHZ', 'drm', ['gt/gt0/rps_cur_freq_mhz', 'gt_cur_freq_mhz',
+                              'device/gt_cur_freq_mhz'], 1),
+    ],
+}
+
+
+def read_text(path):
+    """Read a small text file, None if it cannot be read"""
+    try:
+        with open(path, 'r') as f:
+            return f.read().strip()
+    except OSError:
+        return None
+
+
+class Attribute:
+    """One sysfs file feeding one metric of one GPU"""
+    __slots__ = ('gpu', 'metric', 'path', 'scale', 'fd')
+
+    def __init__(self, gpu, metric, path, scale):
+        self.gpu = gpu
+        self.metric = metric
+        self.path = path
+        self.scale = scale
+        self.fd = -1
+
+
+class CollectorGPU:
+    """A discovered GPU and the sysfs attributes sampled for it"""
+
+    def __init__(self, index, device_path, vendor_id, device_id):
+        self.index = index
+        self.device_path = device_path
+        self.pci_address = os.path.basename(device_path)
+        self.vendor_id = vendor_id
+        self.device_id = device_id
+
+        vendor_name, default_driver = VENDOR_NAMES.get(vendor_id, ('Unknown', 'unknown'))
+        self.name = f"{vendor_name} GPU [{vendor_id:04x}:{device_id:04x}]"
+
+        driver_link = os.path.join(device_path, 'driver')
+        if os.path.islink(driver_link):
+            self.driver = os.path.basename(os.readlink(driver_link))
+        else:
+            self.driver = default_driver
+
+        self.drm_path = self._first_child('drm', 'card')
+        self.hwmon_path = self._first_child('hwmon', 'hwmon')
+        self.attributes = []
+
+    def _first_child(self, subdir, prefix):
+        """Find e.g. <device>/drm/card0 or <device>/hwmon/hwmon3"""
+        parent = os.path.join(self.device_path, subdir)
+        try:
+            names = sorted(n for n in os.listdir(parent)
+                           if n.startswith(prefix) and n[len(prefix):].isdigit())
+        except OSError:
+            return None
+        return os.path.join(parent, names[0]) if names else None
+
+    def resolve_attributes(self):
+        """Pick the sysfs files to sample based on vendor and what exists"""
+        bases = {'device': self.device_path, 'drm': self.drm_path, 'hwmon': self.hwmon_path}
+
+        for metric, base, candidates, scale in ATTRIBUTE_TABLE.get(self.vendor_id, []):
+            base_path = bases[base]
+            if not base_path:
+                continue
+            for candidate in candidates:
+                path = os.path.join(base_path, candidate)
+                if os.path.exists(path):
+                    self.attributes.append(Attribute(self, metric, path, scale))
+                    break
+
+
+def discover_gpus(sysfs_root=SYSFS_ROOT):
+    """Find display-class PCI devices, like detect_gpus() in the module"""
+    devices_dir = os.path.join(sysfs_root, 'bus/pci/devices')
+    gpus = []
+
+    try:
+        addresses = sorted(os.listdir(devices_dir))
+    except OSError:
+        return gpus
+
+    for address in addresses:
+        device_path = os.path.join(devices_dir, address)
+        try:
+            pci_class = int(read_text(os.path.join(device_path, 'class')), 16) >> 8
+            vendor_id = int(read_text(os.path.join(device_path, 'vendor')), 16)
+            device_id = int(read_text(os.path.join(device_path, 'device')), 16)
+        except (TypeError, ValueError):
+            continue
+
+        if pci_class not in (PCI_CLASS_VGA, PCI_CLASS_3D):
+            continue
+
+        gpu = CollectorGPU(len(gpus), device_path, vendor_id, device_id)
+        gpu.resolve_attributes()
+        gpus.append(gpu)
+
+    return gpus
+
+
+# ---------------------------------------------------------------------------
+# Attribute readers
+# ---------------------------------------------------------------------------
+
+class PreadReader:
+    """Reads every registered attribute with its own pread(2)"""
+    name = 'pread'
+
+    def __init__(self, fds):
+        self.fds = fds
+        self.syscalls = 0
+
+    def read_all(self):
+        results = []
+        for fd in self.fds:
+            try:
+                results.append(os.pread(fd, ATTR_BUFFER_SIZE, 0))
+            except OSError:
+                results.append(None)
+        self.syscalls += len(self.fds)
+        return results
+
+    def close(self):
+        pass
+
+
+# io_uring ABI (include/uapi/linux/io_uring.h); syscall numbers are shared
+# by all architectures using the generic syscall table
+NR_IO_URING_SETUP = 425
+NR_IO_URING_ENTER = 426
+NR_IO_URING_REGISTER = 427
+
+IORING_OFF_SQ_RING = 0
+IORING_OFF_CQ_RING = 0x8000000
+IORING_OFF_SQES = 0x10000000
+
+IORING_FEAT_SINGLE_MMAP = 1 << 0
+IORING_ENTER_GETEVENTS = 1 << 0
+IORING_REGISTER_BUFFERS = 0
+IORING_REGISTER_FILES = 2
+IORING_OP_READ_FIXED = 4
+IOSQE_FIXED_FILE = 1 << 0
+
+IORING_MAX_ENTRIES = 32768
+
+
+class _SQRingOffsets(ctypes.Structure):
+    _fields_ = [('head', ctypes.c_uint32), ('tail', ctypes.c_uint32),
+                ('ring_mask', ctypes.c_uint32), ('ring_entries', ctypes.c_uint32),
+                ('flags', ctypes.c_uint32), ('dropped', ctypes.c_uint32),
+                ('array', ctypes.c_uint32), ('resv1', ctypes.c_uint32),
+                ('user_addr', ctypes.c_uint64)]
+
+
+class _CQRingOffsets(ctypes.Structure):
+    _fields_ = [('head', ctypes.c_uint32), ('tail', ctypes.c_uint32),
+                ('ring_mask', ctypes.c_uint32), ('ring_entries', ctypes.c_uint32),
+                ('overflow', ctypes.c_uint32), ('cqes', ctypes.c_uint32),
+                ('flags', ctypes.c_uint32), ('resv1', ctypes.c_uint32),
+                ('user_addr', ctypes.c_uint64)]
+
+
+class _IoUringParams(ctypes.Structure):
+    _fields_ = [('sq_entries', ctypes.c_uint32), ('cq_entries', ctypes.c_uint32),
+                ('flags', ctypes.c_uint32), ('sq_thread_cpu', ctypes.c_uint32),
+                ('sq_thread_idle', ctypes.c_uint32), ('features', ctypes.c_uint32),
+                ('wq_fd', ctypes.c_uint32), ('resv', ctypes.c_uint32 * 3),
+                ('sq_off', _SQRingOffsets), ('cq_off', _CQRingOffsets)]
+
+
+class _IoUringSQE(ctypes.Structure):
+    _fields_ = [('opcode', ctypes.c_uint8), ('flags', ctypes.c_uint8),
+                ('ioprio', ctypes.c_uint16), ('fd', ctypes.c_int32),
+                ('off', ctypes.c_uint64), ('addr', ctypes.c_uint64),
+                ('len', ctypes.c_uint32), ('rw_flags', ctypes.c_uint32),
+                ('user_data', ctypes.c_uint64), ('buf_index', ctypes.c_uint16),
+                ('personality', ctypes.c_uint16), ('splice_fd_in', ctypes.c_int32),
+                ('addr3', ctypes.c_uint64), ('pad2', ctypes.c_uint64)]
+
+
+class _IoUringCQE(ctypes.Structure):
+    _fields_ = [('user_data', ctypes.c_uint64), ('res', ctypes.c_int32),
+                ('flags', ctypes.c_uint32)]
+
+
+class _IOVec(ctypes.Structure):
+    _fields_ = [('iov_base', ctypes.c_void_p), ('iov_len', ctypes.c_size_t)]
+
+
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+
+def _syscall(nr, *args):
+    ret = _libc.syscall(ctypes.c_long(nr), *args)
+    if ret < 0:
+        err = ctypes.get_errno()
+        raise OSError(err, os.strerror(err))
+    return ret
+
+
+class IoUringReader:
+    """
+    Reads all registered attributes with one io_uring_enter(2) per epoch.
+
+    The attribute fds and one buffer holding a slot per attribute are
+    registered with the ring at startup. Submission entries never change
+    between epochs (fixed file i, offset 0, buffer slot i), so an epoch only
+    republishes their indices, bumps the SQ tail and waits for all
+    completions in the same call.
+    """
+    name = 'io_uring'
+
+    def __init__(self, fds):
+        self.fds = fds
+        self.syscalls = 0
+        self.ring_fd = -1
+        self._maps = []
+
+        count = len(fds)
+        if count == 0 or count > IORING_MAX_ENTRIES:
+            raise OSError(errno.EINVAL, f"cannot batch {count} attributes")
+
+        params = _IoUringParams()
+        self.ring_fd = _syscall(NR_IO_URING_SETUP, ctypes.c_uint32(count), ctypes.byref(params))
+        try:
+            self._map_rings(params)
+            self._register(count)
+        except Exception:
+            self.close()
+            raise
+
+    def _map(self, length, offset):
+        region = mmap.mmap(self.ring_fd, length, flags=mmap.MAP_SHARED,
+                           prot=mmap.PROT_READ | mmap.PROT_WRITE, offset=offset)
+        self._maps.append(region)
+        return region
+
+    def _map_rings(self, params):
+        sq_off, cq_off = params.sq_off, params.cq_off
+        sq_size = sq_off.array + params.sq_entries * 4
+        cq_size = cq_off.cqes + params.cq_entries * ctypes.sizeof(_IoUringCQE)
+
+        if params.features & IORING_FEAT_SINGLE_MMAP:
+            sq_ring = cq_ring = self._map(max(sq_size, cq_size), IORING_OFF_SQ_RING)
+        else:
+            sq_ring = self._map(sq_size, IORING_OFF_SQ_RING)
+            cq_ring = self._map(cq_size, IORING_OFF_CQ_RING)
+        sqes = self._map(params.sq_entries * ctypes.sizeof(_IoUringSQE), IORING_OFF_SQES)
+
+        self.sq_tail = ctypes.c_uint32.from_buffer(sq_ring, sq_off.tail)
+        self.sq_mask = ctypes.c_uint32.from_buffer(sq_ring, sq_off.ring_mask).value
+        self.sq_array = (ctypes.c_uint32 * params.sq_entries).from_buffer(sq_ring, sq_off.array)
+        self.sqes = (_IoUringSQE * params.sq_entries).from_buffer(sqes)
+
+        self.cq_head = ctypes.c_uint32.from_buffer(cq_ring, cq_off.head)
+        self.cq_tail = ctypes.c_uint32.from_buffer(cq_ring, cq_off.tail)
+        self.cq_mask = ctypes.c_uint32.from_buffer(cq_ring, cq_off.ring_mask).value
+        self.cqes = (_IoUringCQE * params.cq_entries).from_buffer(cq_ring, cq_off.cqes)
+
+    def _register(self, count):
+        files = (ctypes.c_int32 * count)(*self.fds)
+        _syscall(NR_IO_URING_REGISTER, ctypes.c_uint(self.ring_fd),
+                 ctypes.c_uint(IORING_REGISTER_FILES), files, ctypes.c_uint(count))
+
+        self.buffer = mmap.mmap(-1, count * ATTR_BUFFER_SIZE)
+        self._maps.append(self.buffer)
+        base = ctypes.addressof(ctypes.c_char.from_buffer(self.buffer))
+        iov = _IOVec(base, count * ATTR_BUFFER_SIZE)
+        _syscall(NR_IO_URING_REGISTER, ctypes.c_uint(self.ring_fd),
+                 ctypes.c_uint(IORING_REGISTER_BUFFERS), ctypes.byref(iov), ctypes.c_uint(1))
+
+        for i in range(count):
+            sqe = self.sqes[i]
+            ctypes.memset(ctypes.byref(sqe), 0, ctypes.sizeof(sqe))
+            sqe.opcode = IORING_OP_READ_FIXED
+            sqe.flags = IOSQE_FIXED_FILE
+            sqe.fd = i
+            sqe.off = 0
+            sqe.addr = base + i * ATTR_BUFFER_SIZE
+            sqe.len = ATTR_BUFFER_SIZE
+            sqe.buf_index = 0
+            sqe.user_data = i
+
+    def _enter(self, to_submit, min_complete):
+        while True:
+            try:
+                self.syscalls += 1
+                return _syscall(NR_IO_URING_ENTER, ctypes.c_uint(self.ring_fd),
+                                ctypes.c_uint(to_submit), ctypes.c_uint(min_complete),
+                                ctypes.c_uint(IORING_ENTER_GETEVENTS), None, ctypes.c_size_t(0))
+            except InterruptedError:
+                continue
+
+    def read_all(self):
+        count = len(self.fds)
+        tail = self.sq_tail.value
+        for i in range(count):
+            self.sq_array[(tail + i) & self.sq_mask] = i
+        self.sq_tail.value = (tail + count) & 0xffffffff
+
+        submitted = self._enter(count, count)
+        if submitted != count:
+            raise OSError(errno.EIO, f"io_uring submitted {submitted} of {count} reads")
+
+        results = [None] * count
+        reaped = 0
+        while True:
+            head = self.cq_head.value
+            cq_tail = self.cq_tail.value
+            while head != cq_tail:
+                cqe = self.cqes[head & self.cq_mask]
+                results[cqe.user_data] = cqe.res
+                head = (head + 1) & 0xffffffff
+                reaped += 1
+            self.cq_head.value = head
+            if reaped >= count:
+                break
+            self._enter(0, count - reaped)
+
+        out = []
+        for i, res in enumerate(results):
+            if res >= 0:
+                start = i * ATTR_BUFFER_SIZE
+                out.append(self.buffer[start:start + res])
+            else:
+                # Completion error: retry this attribute synchronously
+                try:
+                    self.syscalls += 1
+                    out.append(os.pread(self.fds[i], ATTR_BUFFER_SIZE, 0))
+                except OSError:
+                    out.append(None)
+        return out
+
+    def close(self):
+        for region in self._maps:
+            try:
+                region.close()
+            except BufferError:
+                pass  # ctypes views still alive; released with the object
+        self._maps = []
+        if self.ring_fd >= 0:
+            os.close(self.ring_fd)
+            self.ring_fd = -1
+
+
+def make_reader(fds, use_uring=True):
+    """Create the batched io_uring reader, falling back to pread"""
+    if use_uring and fds:
+        try:
+            return IoUringReader(fds)
+        except OSError as e:
+            print(f"⚠️  io_uring unavailable ({e.strerror}), using pread", file=sys.stderr)
+    return PreadReader(fds)
+
+
+# ---------------------------------------------------------------------------
+# Sampling
+# ---------------------------------------------------------------------------
+
+class Sample:
+    """
+    Values of every metric of every GPU from one sampling epoch.
+    values is flat: values[gpu_index * metric_count + metric_index], NaN
+    where a GPU does not provide a metric.
+    """
+    __slots__ = ('seq', 'timestamp_ns', 'values')
+
+    def __init__(self, seq, timestamp_ns, values):
+        self.seq = seq
+        self.timestamp_ns = timestamp_ns
+        self.values = values
+
+
+class GPUCollector:
+    """Discovers GPUs once and samples all their attributes per epoch"""
+
+    def __init__(self, sysfs_root=SYSFS_ROOT, interval=1.0, use_uring=True, derived=None,
+                 plugins=(), nvml=None, uncore=None):
+        self.sysfs_root = sysfs_root
+        self.interval = interval
+        self.gpus = discover_gpus(sysfs_root)
+        self.topology = build_topology(self.gpus)
+
+        # Metric order: sysfs, NVML-only, uncore, plugin metrics, derived metrics
+        native = native_metrics(nvml, plugins, uncore)
+        self.derived = derived if derived is not None and derived.derived else None
+        if self.derived and self.derived.native != native:
+            raise ValueError("derived metrics were compiled for a different metric list")
+        self.metrics = self.derived.metrics if self.derived else native
+        self.metric_index = {name: i for i, name in enumerate(self.metrics)}
+
+        self.plugins = []
+        for plugin in plugins:
+            try:
+                plugin.discover(self.gpus)
+            except PluginError as e:
+                print(f"⚠️  {e}; its metrics stay empty", file=sys.stderr)
+                continue
+            plugin.map_slots(self.metric_index, len(self.metrics))
+            self.plugins.append(plugin)
+
+        self.nvml = nvml
+        if nvml is not None:
+            nvml.attach(self.gpus, self.metric_index, len(self.metrics))
+        self.uncore = uncore
+        if uncore is not None:
+            uncore.attach(self.gpus, self.metric_index, len(self.metrics))
+        self.seq = 0
+
+        self.attributes = []
+        for gpu in self.gpus:
+            for attr in gpu.attributes:
+                try:
+                    attr.fd = os.open(attr.path, os.O_RDONLY | os.O_CLOEXEC)
+                except OSError:
+                    continue
+                self.attributes.append(attr)
+
+        # Flat value index of every attribute, computed once
+        self._slots = [attr.gpu.index * len(self.metrics) + self.metric_index[attr.metric]
+                       for attr in self.attributes]
+        self.reader = make_reader([attr.fd for attr in self.attributes], use_uring)
+
+    def sample(self):
+        """Read every attribute once and return the epoch's Sample"""
+        try:
+            raw = self.reader.read_all()
+        except OSError as e:
+            # The ring broke at runtime; continue on pread for good
+            print(f"⚠️  {self.reader.name} read failed ({e}), switching to pread", file=sys.stderr)
+            self.reader.close()
+            self.reader = PreadReader([attr.fd for attr in self.attributes])
+            raw = self.reader.read_all()
+
+        values = [math.nan] * (len(self.gpus) * len(self.metrics))
+        for slot, attr, data in zip(self._slots, self.attributes, raw):
+            if not data:
+                continue
+            try:
+                values[slot] = int(data.split(b'\n', 1)[0]) * attr.scale
+            except ValueError:
+                continue
+
+        # NVML readings replace the (mostly absent) hwmon ones
+        if self.nvml is not None:
+            self.nvml.sample(values)
+
+        timestamp_ns = time.monotonic_ns()
+        if self.uncore is not None:
+            self.uncore.sample(timestamp_ns, values)
+        for plugin in self.plugins:
+            plugin.sample(timestamp_ns, values)
+        if self.derived:
+            self.derived.evaluate(values, len(self.gpus))
+
+        self.seq += 1
+        return Sample(self.seq, timestamp_ns, values)
+
+    def schema(self):
+        """Description of the sample layout sent to clients on connect"""
+        return {
+            'version': PROTOCOL_VERSION,
+            'interval': self.interval,
+            'metrics': self.metrics,
+            'derived': {metric.name: metric.text
+                        for metric in (self.derived.derived if self.derived else [])},
+            'gpus': [{'index': gpu.index, 'name': gpu.name,
+                      'vendor_id': gpu.vendor_id, 'device_id': gpu.device_id,
+                      'driver': gpu.driver, 'pci_address': gpu.pci_address,
+                      'pci_path': gpu.device_path}
+                     for gpu in self.gpus],
+        }
+
+    def refresh_topology(self):
+        """Rebuild the topology (after hotplug); True if it changed"""
+        topology = build_topology(self.gpus)
+        if topology == self.topology:
+            return False
+        self.topology = topology
+        return True
+
+    def value(self, sample, gpu_index, metric):
+        return sample.values[gpu_index * len(self.metrics) + self.metric_index[metric]]
+
+    def format_sample(self, sample):
+        """Render a sample in the /proc/gpu_monitor text format"""
+        lines = [f"GPU_COUNT:{len(self.gpus)}",
+                 f"SEQ:{sample.seq}",
+                 f"TIMESTAMP_NS:{sample.timestamp_ns}",
+                 "DATA_SOURCE:GPU_COLLECTOR",
+                 ""]
+        for gpu in self.gpus:
+            i = gpu.index
+            lines.append(f"GPU_{i}_NAME:{gpu.name}")
+            lines.append(f"GPU_{i}_VENDOR_ID:0x{gpu.vendor_id:04x}")
+            lines.append(f"GPU_{i}_DEVICE_ID:0x{gpu.device_id:04x}")
+            lines.append(f"GPU_{i}_DRIVER:{gpu.driver}")
+            lines.append(f"GPU_{i}_PCI_PATH:{gpu.device_path}")
+            for metric in self.metrics:
+                value = self.value(sample, i, metric)
+                if not math.isnan(value):
+                    precision = 0 if metric in METRICS or metric in NVML_METRICS or \
+                        metric in UNCORE_METRICS else 2
+                    lines.append(f"GPU_{i}_{metric}:{value:.{precision}f}")
+            lines.append("")
+        return '\n'.join(lines)
+
+    def run(self, on_sample, count=None):
+        """Sample on a fixed monotonic schedule until count epochs are done"""
+        deadline = time.monotonic()
+        while count is None or self.seq < count:
+            on_sample(self.sample())
+            deadline += self.interval
+            delay = deadline - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+            else:
+                deadline = time.monotonic()  # Overran; don't try to catch up
+
+    def close(self):
+        self.reader.close()
+        if self.nvml is not None:
+            self.nvml.close()
+        if self.uncore is not None:
+            self.uncore.close()
+        for plugin in self.plugins:
+            plugin.close()
+        self.plugins = []
+        for attr in self.attributes:
+            os.close(attr.fd)
+        self.attributes = []
+
+
+# ---------------------------------------------------------------------------
+# History
+# ---------------------------------------------------------------------------
+
+class HistoryRing:
+    """
+    Preallocated ring of the most recent samples, stored as float32 rows
+    of the collector's flat value layout. Serves backfill on subscribe.
+    """
+
+    def __init__(self, capacity, width):
+        self.capacity = capacity
+        self.width = width
+        self.values = array('f', bytes(4 * capacity * width))
+        self.seqs = array('Q', bytes(8 * capacity))
+        self.stamps = array('Q', bytes(8 * capacity))
+        self.head = 0
+        self.count = 0
+
+    def append(self, sample):
+        row = self.head * self.width
+        self.values[row:row + self.width] = array('f', sample.values)
+        self.seqs[self.head] = sample.seq
+        self.stamps[self.head] = sample.timestamp_ns
+        self.head = (self.head + 1) % self.capacity
+        if self.count < self.capacity:
+            self.count += 1
+
+    def rows_since(self, start_ns):
+        """Ring positions of samples at or after start_ns, oldest first"""
+        first = (self.head - self.count) % self.capacity
+        positions = [(first + k) % self.capacity for k in range(self.count)]
+        # Timestamps are monotonic: skip the old prefix
+        lo, hi = 0, len(positions)
+        while lo < hi:
+            mid = (lo + hi) // 2
+            if self.stamps[positions[mid]] < start_ns:
+                lo = mid + 1
+            else:
+                hi = mid
+        return positions[lo:]
+
+
+# ---------------------------------------------------------------------------
+# Subscription server
+# ---------------------------------------------------------------------------
+
+class Subscriber:
+    """
+    One client connection. Control frames are always delivered; sample
+    frames go through a bounded queue governed by the slow-consumer policy.
+    """
+    MAX_QUEUE = 4096
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.decoder = FrameDecoder()
+        self.control = deque()
+        self.samples = deque()
+        self.current = b''
+        self.offset = 0
+        self.writing = False
+
+        # Subscription; no samples until the client subscribes
+        self.slots = None
+        self.period_ns = 0
+        self.next_due_ns = 0
+        self.policy = POLICY_DROP_OLDEST
+        self.queue_limit = 64
+        self.unreported_drops = 0
+        self.dropped_total = 0
+        self.topology_updates = False  # Asked for the topology, resend on change
+
+    def due(self, timestamp_ns, tolerance_ns):
+        """Per-subscriber decimation of the acquisition stream"""
+        if self.slots is None:
+            return False
+        if self.period_ns == 0:
+            return True
+        if timestamp_ns + tolerance_ns < self.next_due_ns:
+            return False
+        self.next_due_ns += self.period_ns
+        if self.next_due_ns <= timestamp_ns:
+            self.next_due_ns = timestamp_ns + self.period_ns  # Resync after a stall
+        return True
+
+    def queue_sample(self, frame):
+        if self.policy == POLICY_COALESCE:
+            dropped = len(self.samples)
+            self.samples.clear()
+        else:
+            dropped = 0
+            while len(self.samples) >= self.queue_limit:
+                self.samples.popleft()
+                dropped += 1
+        self.samples.append(frame)
+        self.unreported_drops += dropped
+        self.dropped_total += dropped
+
+    def _next_chunk(self):
+        if self.control:
+            return self.control.popleft()
+        if self.samples:
+            if self.unreported_drops:
+                frame = encode_json(MSG_DROPPED, {'dropped': self.unreported_drops})
+                self.unreported_drops = 0
+                return frame
+            return self.samples.popleft()
+        return None
+
+    def pending(self):
+        return bool(self.current) or bool(self.control) or bool(self.samples)
+
+    def flush(self):
+        """Write as much as the socket accepts; False if the peer is gone"""
+        while True:
+            if not self.current:
+                chunk = self._next_chunk()
+                if chunk is None:
+                    return True
+                self.current = memoryview(chunk)
+                self.offset = 0
+            try:
+                sent = self.sock.send(self.current[self.offset:])
+            except (BlockingIOError, InterruptedError):
+                return True
+            except OSError:
+                return False
+            self.offset += sent
+            if self.offset < len(self.current):
+                return True
+            self.current = b''
+
+
+class CollectorServer:
+    """Single-threaded acquisition loop with non-blocking fan-out"""
+
+    def __init__(self, collector, path, history_seconds=600, recorder=None, idle=None,
+                 alerts=None, uplink=None):
+        self.collector = collector
+        self.path = path
+        self.recorder = recorder
+        self.idle = idle
+        self.alerts = alerts
+        self.uplink = uplink
+        self.selector = selectors.DefaultSelector()
+        self.subscribers = {}
+
+        capacity = max(1, int(math.ceil(history_seconds / collector.interval)))
+        self.history = HistoryRing(capacity, len(collector.gpus) * len(collector.metrics))
+
+        if os.path.exists(path):
+            os.unlink(path)  # Stale socket from a previous run
+        self.listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.listener.bind(path)
+        self.listener.listen(64)
+        self.listener.setblocking(False)
+        self.selector.register(self.listener, selectors.EVENT_READ)
+
+        self.schema_frame = encode_json(MSG_SCHEMA, collector.schema())
+        self.tolerance_ns = int(collector.interval * 1e9 / 2)
+        self.web = None
+
+        # Encoded once per change; a query is a queued frame, not a sysfs walk
+        self.topology_frame = encode_json(MSG_TOPOLOGY, collector.topology)
+        self.hotplug = HotplugMonitor(TOPOLOGY_SUBSYSTEMS)
+        if self.hotplug.sock is not None:
+            self.selector.register(self.hotplug.sock, selectors.EVENT_READ, self._hotplug)
+        if uplink is not None:
+            uplink.attach(self.selector)
+
+    def serve_web(self, host, port, rate_hz):
+        """Also serve the browser dashboard from this loop"""
+        self.web = WebDashboard(self.collector, self.selector, host, port, rate_hz)
+        return self.web
+
+    def _accept(self):
+        try:
+            sock, _ = self.listener.accept()
+        except (BlockingIOError, InterruptedError):
+            return
+        sock.setblocking(False)
+        sub = Subscriber(sock)
+        sub.control.append(self.schema_frame)
+        self.subscribers[sock.fileno()] = sub
+        self.selector.register(sock, selectors.EVENT_READ, sub)
+        self._flush(sub)
+
+    def publish_alert(self, event):
+        """Alert transitions go to every subscriber as control frames"""
+        frame = encode_json(MSG_ALERT, event)
+        for sub in list(self.subscribers.values()):
+            if sub.slots is not None:
+                sub.control.append(frame)
+                self._flush(sub)
+
+    def _hotplug(self, events):
+        if not self.hotplug.changed() or not self.collector.refresh_topology():
+            return
+        self.topology_frame = encode_json(MSG_TOPOLOGY, self.collector.topology)
+        print("🔀 GPU topology changed", file=sys.stderr)
+        for sub in list(self.subscribers.values()):
+            if sub.topology_updates:
+                sub.control.append(self.topology_frame)
+                self._flush(sub)
+
+    def _drop(self, sub):
+        self.selector.unregister(sub.sock)
+        del self.subscribers[sub.sock.fileno()]
+        sub.sock.close()
+
+    def _flush(self, sub):
+        if not sub.flush():
+            self._drop(sub)
+            return
+        writing = sub.pending()
+        if writing != sub.writing:
+            events = selectors.EVENT_READ | (selectors.EVENT_WRITE if writing else 0)
+            self.selector.modify(sub.sock, events, sub)
+            sub.writing = writing
+
+    def _read(self, sub):
+        try:
+            data = sub.sock.recv(65536)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            data = b''
+        if not data:
+            self._drop(sub)
+            return
+
+        sub.decoder.feed(data)
+        try:
+            for msg_type, _flags, payload in sub.decoder.frames():
+                self._handle(sub, msg_type, payload)
+        except ValueError as e:
+            sub.control.append(encode_json(MSG_ERROR, {'error': str(e)}))
+        self._flush(sub)
+
+    def _handle(self, sub, msg_type, payload):
+        try:
+            request = json.loads(payload) if payload else {}
+        except ValueError:
+            raise ValueError("malformed JSON request")
+
+        if msg_type == MSG_SUBSCRIBE:
+            self._subscribe(sub, request)
+        elif msg_type == MSG_ANNOTATE:
+            gpu = request.get('gpu')
+            if gpu is not None and not (isinstance(gpu, int) and 0 <= gpu < len(self.collector.gpus)):
+                raise ValueError(f"unknown GPU {gpu}")
+            if self.recorder is not None:
+                self.recorder.annotate(request.get('text', ''), gpu)
+        elif msg_type == MSG_GET_TOPOLOGY:
+            sub.topology_updates = True
+            sub.control.append(self.topology_frame)
+        elif msg_type == MSG_GET_IDLE:
+            if self.idle is None:
+                raise ValueError("idle tracking is disabled")
+            min_minutes = request.get('min_minutes')
+            if min_minutes is not None and not (
+                    isinstance(min_minutes, (int, float)) and min_minutes >= 0):
+                raise ValueError("min_minutes must be non-negative")
+            sub.control.append(encode_json(MSG_IDLE, self.idle.report(min_minutes)))
+        else:
+            raise ValueError(f"unknown message type {msg_type}")
+
+    def _subscribe(self, sub, request):
+        collector = self.collector
+        gpus = request.get('gpus')
+        metrics = request.get('metrics')
+        rate_hz = request.get('rate_hz')
+        policy = request.get('policy', POLICY_DROP_OLDEST)
+        queue = request.get('queue', 64)
+        backfill_seconds = request.get('backfill_seconds')
+
+        if gpus is None:
+            gpus = [gpu.index for gpu in collector.gpus]
+        if metrics is None:
+            metrics = list(collector.metrics)
+        for index in gpus:
+            if not isinstance(index, int) or not 0 <= index < len(collector.gpus):
+                raise ValueError(f"unknown GPU {index}")
+        for name in metrics:
+            if name not in collector.metric_index:
+                raise ValueError(f"unknown metric {name}")
+        if rate_hz is not None and not (isinstance(rate_hz, (int, float)) and rate_hz > 0):
+            raise ValueError("rate_hz must be positive")
+        if policy not in POLICIES:
+            raise ValueError(f"policy must be one of {', '.join(POLICIES)}")
+        if not isinstance(queue, int) or not 1 <= queue <= Subscriber.MAX_QUEUE:
+            raise ValueError(f"queue must be 1..{Subscriber.MAX_QUEUE}")
+        if backfill_seconds is not None and not (
+                isinstance(backfill_seconds, (int, float)) and backfill_seconds >= 0):
+            raise ValueError("backfill_seconds must be non-negative")
+
+        metric_count = len(collector.metrics)
+        sub.slots = tuple(g * metric_count + collector.metric_index[m]
+                          for g in gpus for m in metrics)
+        sub.format = sample_struct(len(sub.slots))
+        # Rates at or above the acquisition rate get every sample
+        if rate_hz is None or 1.0 / rate_hz <= collector.interval:
+            sub.period_ns = 0
+        else:
+            sub.period_ns = int(1e9 / rate_hz)
+        sub.next_due_ns = 0
+        sub.policy = policy
+        sub.queue_limit = queue
+        sub.samples.clear()
+
+        sub.control.append(encode_json(MSG_SUBSCRIBED, {
+            'gpus': gpus, 'metrics': metrics,
+            'rate_hz': rate_hz, 'policy': policy, 'queue': queue,
+            'columns': [[g, m] for g in gpus for m in metrics],
+        }))
+        if backfill_seconds is not None:
+            sub.control.append(self._backfill(sub, backfill_seconds))
+
+    def _backfill(self, sub, seconds):
+        """
+        One bulk frame with the subscriber's selection over the last
+        seconds of history, decimated like its live stream. Live samples
+        continue from where the backfill ends.
+        """
+        history = self.history
+        start_ns = time.monotonic_ns() - int(seconds * 1e9)
+        payload = bytearray(BACKFILL_HEADER.size)
+        count = 0
+        for pos in history.rows_since(start_ns):
+            stamp = history.stamps[pos]
+            if not sub.due(stamp, self.tolerance_ns):
+                continue
+            base = pos * history.width
+            values = history.values
+            payload += sub.format.pack(history.seqs[pos], stamp,
+                                       *[values[base + slot] for slot in sub.slots])
+            count += 1
+        BACKFILL_HEADER.pack_into(payload, 0, count)
+        return encode_frame(MSG_BACKFILL, bytes(payload))
+
+    def publish(self, sample):
+        """Fan one sample out; each distinct selection is encoded once"""
+        encoded = {}
+        for sub in list(self.subscribers.values()):
+            if not sub.due(sample.timestamp_ns, self.tolerance_ns):
+                continue
+            frame = encoded.get(sub.slots)
+            if frame is None:
+                values = sample.values
+                payload = sub.format.pack(sample.seq, sample.timestamp_ns,
+                                          *[values[slot] for slot in sub.slots])
+                frame = encoded[sub.slots] = encode_frame(MSG_SAMPLE, payload)
+            sub.queue_sample(frame)
+            self._flush(sub)
+
+    def serve_forever(self):
+        interval = self.collector.interval
+        deadline = time.monotonic()
+        while True:
+            timeout = max(0.0, deadline - time.monotonic())
+            for key, events in self.selector.select(timeout):
+                if key.fileobj is self.listener:
+                    self._accept()
+                    continue
+                if callable(key.data):
+                    key.data(events)  # Web dashboard connection, hotplug or aggregator uplink
+                    continue
+                sub = key.data
+                if events & selectors.EVENT_READ:
+                    self._read(sub)
+                if events & selectors.EVENT_WRITE and sub.sock.fileno() in self.subscribers:
+                    self._flush(sub)
+
+            now = time.monotonic()
+            if now >= deadline:
+                sample = self.collector.sample()
+                self.history.append(sample)
+                if self.recorder is not None:
+                    self.recorder.write_sample(sample)
+                if self.idle is not None:
+                    self.idle.add(sample.timestamp_ns, sample.values)
+                if self.alerts is not None:
+                    self.alerts.evaluate(sample.timestamp_ns, sample.values)
+                if self.uplink is not None:
+                    self.uplink.add(sample)
+                self.publish(sample)
+                if self.web is not None:
+                    self.web.publish(sample, self.tolerance_ns)
+                deadline += interval
+                if deadline <= now:
+                    deadline = now + interval  # Overran; don't try to catch up
+
+    def close(self):
+        for sub in list(self.subscribers.values()):
+            self._drop(sub)
+        if self.web is not None:
+            self.web.close()
+        if self.uplink is not None:
+            self.uplink.detach()
+        self.hotplug.close()
+        self.selector.close()
+        self.listener.close()
+        try:
+            os.unlink(self.path)
+        except OSError:
+            pass
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="GPU telemetry collector")
+    parser.add_argument('--interval', type=float, default=1.0, help="sampling interval in seconds")
+    parser.add_argument('--count', type=int, default=None, help="stop after this many samples")
+    parser.add_argument('--sysfs-root', default=SYSFS_ROOT, help="alternate sysfs tree")
+    parser.add_argument('--pread', action='store_true', help="disable io_uring batching")
+    parser.add_argument('--stats', action='store_true', help="print syscalls per sample")
+    parser.add_argument('--serve', action='store_true', help="serve subscriptions instead of printing")
+    parser.add_argument('--socket', default=None, help="Unix socket path for --serve")
+    parser.add_argument('--history', type=float, default=600,
+                        help="seconds of history kept for backfill")
+    parser.add_argument('--nvml', default='auto', metavar='auto|off|LIB',
+                        help="NVML for NVIDIA GPUs: auto (when installed), off, or a library path")
+    parser.add_argument('--uncore', default='auto', choices=['auto', 'on', 'off'],
+                        help="Intel iGPU memory bandwidth from uncore IMC counters "
+                             "(auto: when the PMU can be opened)")
+    parser.add_argument('--plugin', action='append', default=[], metavar='SO',
+                        help="metric source plugin (shared object, see gpu_collector_plugin.h)")
+    parser.add_argument('--derive', action='append', default=[], metavar='NAME=EXPR',
+                        help="derived metric, e.g. 'MEMORY_USED_PCT = 100 * MEMORY_USED / MEMORY_TOTAL'")
+    parser.add_argument('--derive-file', default=None, metavar='FILE',
+                        help="file of derived metric definitions, one per line")
+    parser.add_argument('--http', type=int, default=None, metavar='PORT',
+                        help="with --serve, also serve the web dashboard on this port")
+    parser.add_argument('--http-bind', default='127.0.0.1', help="address for --http")
+    parser.add_argument('--web-rate', type=float, default=2.0,
+                        help="dashboard pushes per second")
+    parser.add_argument('--record', default=None, metavar='FILE',
+                        help="also record every sample to a session file "
+                             "(.parquet/.arrow for columnar output)")
+    parser.add_argument('--alert', action='append', default=[], metavar='NAME=CONDITION',
+                        help="alert rule, e.g. 'GPU_HOT = TEMPERATURE > 85 for 30s'")
+    parser.add_argument('--alert-file', default=None, metavar='FILE',
+                        help="file of alert rules, one per line (see alert_rules.conf)")
+    parser.add_argument('--idle-util', type=float, default=IDLE_UTILIZATION, metavar='PCT',
+                        help="a GPU is idle while UTILIZATION stays below this")
+    parser.add_argument('--idle-power', type=float, default=None, metavar='WATTS',
+                        help="... and POWER_WATTS below this (not checked by default)")
+    parser.add_argument('--idle-window', type=float, default=IDLE_WINDOW, metavar='SECONDS',
+                        help="idle rollup window; one busy sample makes its window busy")
+    parser.add_argument('--idle-minutes', type=float, default=IDLE_MINUTES,
+                        help="idle streak that lists a GPU and records an alert")
+    parser.add_argument('--no-idle', action='store_true', help="disable idle tracking")
+    parser.add_argument('--topology', nargs='?', const='matrix', choices=['matrix', 'json'],
+                        default=None, help="print the GPU topology and exit")
+    parser.add_argument('--aggregator', default=None, metavar='ADDR',
+                        help="ship per-window quantile sketches to a fleet aggregator (host:port)")
+    parser.add_argument('--node-name', default=None, help="node name at the aggregator (default: hostname)")
+    parser.add_argument('--node-label', action='append', default=[], metavar='KEY=VALUE',
+                        help="node label at the aggregator, e.g. rack=r12")
+    parser.add_argument('--sketch-window', type=float, default=SKETCH_WINDOW, metavar='SECONDS',
+                        help="window of each sketch and batch sent to the aggregator")
+    args = parser.parse_args()
+
+    if args.topology:
+        topology = build_topology(discover_gpus(args.sysfs_root))
+        print(format_matrix(topology) if args.topology == 'matrix' else json.dumps(topology, indent=2))
+        return
+
+    nvml = None
+    if args.nvml != 'off':
+        try:
+            nvml = load_nvml(None if args.nvml == 'auto' else args.nvml,
+                             required=args.nvml != 'auto')
+        except NVMLError as e:
+            print(f"❌ NVML: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    uncore = None
+    if args.uncore != 'off':
+        try:
+            uncore = load_uncore(args.sysfs_root, required=args.uncore == 'on')
+        except UncoreError as e:
+            print(f"❌ Uncore: {e}", file=sys.stderr)
+            sys.exit(1)
+
+    try:
+        plugins = load_plugins(args.plugin, native_metrics(nvml, uncore=uncore))
+    except PluginError as e:
+        print(f"❌ {e}", file=sys.stderr)
+        sys.exit(1)
+
+    derived = DerivedMetrics(native_metrics(nvml, plugins, uncore))
+    try:
+        if args.derive_file:
+            with open(args.derive_file) as f:
+                derived.load(f)
+        derived.load(args.derive)
+    except (OSError, ExpressionError) as e:
+        print(f"❌ Derived metrics: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    collector = GPUCollector(args.sysfs_root, args.interval, use_uring=not args.pread,
+                             derived=derived, plugins=plugins, nvml=nvml, uncore=uncore)
+    print(f"🔍 Found {len(collector.gpus)} GPU(s), {len(collector.attributes)} attribute(s), "
+          f"reader: {collector.reader.name}", file=sys.stderr)
+    if nvml is not None:
+        print(f"🟩 NVML ({nvml.library}): {len(nvml.devices)} GPU(s)", file=sys.stderr)
+    if uncore is not None:
+        print(f"🧠 Uncore IMC ({len(uncore.pmus)} PMU(s)): {', '.join(uncore.metrics)} "
+              f"on {len(uncore.slots)} integrated GPU(s)", file=sys.stderr)
+    for plugin in collector.plugins:
+        print(f"🔌 Plugin {plugin.name}: {', '.join(plugin.metrics)}", file=sys.stderr)
+    for metric in derived.derived:
+        print(f"🧮 {metric.name} = {metric.text}", file=sys.stderr)
+
+    recorder = None
+    if args.record:
+        fmt = columnar_format(args.record)
+        try:
+            if fmt:
+                recorder = ColumnarRecorder(args.record, collector.schema(), fmt)
+            else:
+                recorder = Recorder(args.record, collector.schema())
+        except (OSError, RuntimeError) as e:
+            print(f"❌ Cannot record to {args.record}: {e}", file=sys.stderr)
+            sys.exit(1)
+        print(f"💾 Recording to {args.record}", file=sys.stderr)
+
+    server = None
+
+    def on_alert(rule, gpu, metric, value, state, timestamp_ns):
+        """Alert transitions are logged, recorded and pushed to subscribers"""
+        if recorder is not None:
+            recorder.alert(rule, gpu, metric, value, state, timestamp_ns)
+        if server is not None:
+            server.publish_alert({'timestamp_ns': timestamp_ns, 'rule': rule, 'gpu': gpu,
+                                  'metric': metric, 'state': state,
+                                  'value': None if value is None or math.isnan(value) else value})
+
+    alerts = None
+    try:
+        rules_text = list(args.alert)
+        if args.alert_file:
+            with open(args.alert_file) as f:
+                rules_text = f.read().splitlines() + rules_text
+        rules = load_rules(rules_text, collector.metrics)
+    except (OSError, ExpressionError) as e:
+        print(f"❌ Alert rules: {e}", file=sys.stderr)
+        sys.exit(1)
+    if rules:
+        def on_rule(rule, gpu, value, state, timestamp_ns):
+            print(f"🚨 {rule.name} firing on GPU {gpu} ({value:.2f})" if state == 'firing'
+                  else f"✅ {rule.name} resolved on GPU {gpu}", file=sys.stderr)
+            on_alert(rule.name, gpu, rule.expression, value, state, timestamp_ns)
+        alerts = AlertEngine(rules, len(collector.gpus), len(collector.metrics), on_rule)
+        for rule in rules:
+            print(f"🚨 {rule.name} = {rule.text}", file=sys.stderr)
+
+    idle = None
+    if not args.no_idle:
+        def on_idle(gpu, metric, value, state, timestamp_ns):
+            print(f"💤 GPU {gpu} idle for {args.idle_minutes:g}+ min" if state == 'firing'
+                  else f"🏃 GPU {gpu} busy again", file=sys.stderr)
+            on_alert(IDLE_RULE, gpu, metric, value, state, timestamp_ns)
+        try:
+            idle = IdleTracker(len(collector.gpus), collector.metrics,
+                               {'UTILIZATION': args.idle_util, 'POWER_WATTS': args.idle_power},
+                               args.idle_window, args.idle_minutes, on_transition=on_idle)
+        except ValueError:
+            idle = None
+
+    uplink = None
+    if args.aggregator:
+        labels = dict(label.partition('=')[::2] for label in args.node_label)
+        uplink = AggregatorUplink(args.aggregator, args.node_name or socket.gethostname(), labels,
+                                  collector.schema(), args.sketch_window)
+        print(f"🛰️  Sketches every {args.sketch_window:g}s to {args.aggregator} as {uplink.node}",
+              file=sys.stderr)
+
+    # Stopping by SIGTERM (kill, systemd) still runs the finally blocks
+    # below, so recordings get their footers
+    signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+
+    if args.serve:
+        server = CollectorServer(collector, args.socket or default_socket_path(),
+                                 args.history, recorder, idle, alerts, uplink)
+        print(f"📡 Serving on {server.path} every {args.interval}s", file=sys.stderr)
+        if args.http is not None:
+            try:
+                web = server.serve_web(args.http_bind, args.http, args.web_rate)
+            except OSError as e:
+                print(f"❌ Cannot serve dashboard on port {args.http}: {e}", file=sys.stderr)
+                server.close()
+                sys.exit(1)
+            print(f"🌐 Dashboard on http://{web.address[0]}:{web.address[1]}/", file=sys.stderr)
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            print("\n🛑 Collector stopped by user", file=sys.stderr)
+        finally:
+            server.close()
+            collector.close()
+            if recorder is not None:
+                recorder.close()
+            if uplink is not None:
+                uplink.close()
+            if idle is not None:
+                print(format_report(idle.report()), file=sys.stderr)
+        return
+
+    def on_sample(sample):
+        syscalls_before = on_sample.syscalls
+        if recorder is not None:
+            recorder.write_sample(sample)
+        if idle is not None:
+            idle.add(sample.timestamp_ns, sample.values)
+        if alerts is not None:
+            alerts.evaluate(sample.timestamp_ns, sample.values)
+        if uplink is not None:
+            uplink.add(sample)
+        print(collector.format_sample(sample), flush=True)
+        if args.stats:
+            on_sample.syscalls = collector.reader.syscalls
+            print(f"# syscalls: {on_sample.syscalls - syscalls_before}", file=sys.stderr)
+    on_sample.syscalls = 0
+
+    try:
+        collector.run(on_sample, args.count)
+    except KeyboardInterrupt:
+        print("\n🛑 Collector stopped by user", file=sys.stderr)
+    finally:
+        collector.close()
+        if recorder is not None:
+            recorder.close()
+        if uplink is not None:
+            uplink.close()
+        if idle is not None:
+            print(format_report(idle.report()), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+/*
+ * GPU Collector Plugin ABI
+ *
+ * Site-specific metric sources for gpu_collector.py, built as shared
+ * objects and loaded with --plugin path.so. A plugin exports one symbol,
+ * gpu_plugin_describe(), returning a static struct gpu_plugin:
+ *
+ *   describe  gpu_plugin_describe() names the plugin and its metrics
+ *   discover  called once with the collector's GPUs; sets up private state
+ *   sample    called once per sampling epoch, in the collector's thread,
+ *             writing into a preallocated values array
+ *   close     releases the state
+ *
+ * The ABI is versioned: fields are only ever appended, and the collector
+ * refuses plugins whose abi_version it does not know.
+ */
+#ifndef GPU_COLLECTOR_PLUGIN_H
+#define GPU_COLLECTOR_PLUGIN_H
+
+#include <stdint.h>
+
+#define GPU_PLUGIN_ABI_VERSION 1
+#define GPU_PLUGIN_PCI_ADDRESS_LEN 16
+
+// One GPU found by the collector, in collector index order
+struct gpu_plugin_device {
+    uint32_t index;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    char pci_address[GPU_PLUGIN_PCI_ADDRESS_LEN];  // "0000:03:00.0"
+    const char *sysfs_path;                       // PCI device directory
+    const char *driver;
+};
+
+struct gpu_plugin {
+    uint32_t abi_version;       // GPU_PLUGIN_ABI_VERSION
+    uint32_t metric_count;
+    const char *name;
+    const char *const *metrics; // metric_count UPPER_CASE names, published as GPU_<n>_<NAME>
+
+    // Return 0 on success or a negative errno; *ctx is passed back to sample/close.
+    // The devices array is only valid during the call.
+    int (*discover)(const struct gpu_plugin_device *devices, uint32_t device_count,
+                    void **ctx);
+
+    // Fill values[device * metric_count + metric]. The array has
+    // device_count * metric_count slots, set to NaN before every call;
+    // slots left NaN mean "not provided". Must not block: it runs inside
+    // the collector's sampling epoch. Return 0 or a negative errno.
+    int (*sample)(void *ctx, uint64_t timestamp_ns, double *values);
+
+    void (*close)(void *ctx);
+};
+
+// The plugin's only exported symbol
+const struct gpu_plugin *gpu_plugin_describe(void);
+
+#endif // GPU_COLLECTOR_PLUGIN_H
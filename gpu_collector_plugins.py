@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+GPU Collector Plugins
+ctypes side of the C plugin ABI in gpu_collector_plugin.h. Each plugin is
+a shared object exporting gpu_plugin_describe(); its metrics are appended
+to the collector's metric list and its sample() callback runs in every
+sampling epoch, writing into a double array allocated once at load time.
+"""
+import ctypes
+import math
+import os
+import re
+import sys
+
+GPU_PLUGIN_ABI_VERSION = 1
+GPU_PLUGIN_PCI_ADDRESS_LEN = 16
+
+_METRIC_NAME = re.compile(r'^[A-Z][A-Z0-9_]*$')
+
+
+class _PluginDevice(ctypes.Structure):
+    _fields_ = [('index', ctypes.c_uint32), ('vendor_id', ctypes.c_uint16),
+                ('device_id', ctypes.c_uint16),
+                ('pci_address', ctypes.c_char * GPU_PLUGIN_PCI_ADDRESS_LEN),
+                ('sysfs_path', ctypes.c_char_p), ('driver', ctypes.c_char_p)]
+
+
+_DISCOVER = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.POINTER(_PluginDevice), ctypes.c_uint32,
+                             ctypes.POINTER(ctypes.c_void_p))
+_SAMPLE = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_uint64,
+                           ctypes.POINTER(ctypes.c_double))
+_CLOSE = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+
+
+class _Plugin(ctypes.Structure):
+    _fields_ = [('abi_version', ctypes.c_uint32), ('metric_count', ctypes.c_uint32),
+                ('name', ctypes.c_char_p), ('metrics', ctypes.POINTER(ctypes.c_char_p)),
+                ('discover', _DISCOVER), ('sample', _SAMPLE), ('close', _CLOSE)]
+
+
+class PluginError(RuntimeError):
+    pass
+
+
+class CollectorPlugin:
+    """One loaded shared object"""
+
+    def __init__(self, path):
+        self.path = path
+        try:
+            self.lib = ctypes.CDLL(os.path.abspath(path))
+            describe = self.lib.gpu_plugin_describe
+        except (OSError, AttributeError) as e:
+            raise PluginError(f"{path}: {e}")
+        describe.restype = ctypes.POINTER(_Plugin)
+        describe.argtypes = []
+
+        info = describe()
+        if not info:
+            raise PluginError(f"{path}: gpu_plugin_describe() returned NULL")
+        self.info = info.contents
+        if self.info.abi_version != GPU_PLUGIN_ABI_VERSION:
+            raise PluginError(f"{path}: ABI version {self.info.abi_version}, "
+                              f"collector supports {GPU_PLUGIN_ABI_VERSION}")
+        if not self.info.discover or not self.info.sample:
+            raise PluginError(f"{path}: discover and sample callbacks are required")
+
+        self.name = (self.info.name or b'').decode() or os.path.basename(path)
+        self.metrics = [self.info.metrics[i].decode() for i in range(self.info.metric_count)]
+        for metric in self.metrics:
+            if not _METRIC_NAME.match(metric):
+                raise PluginError(f"{path}: invalid metric name '{metric}'")
+
+        self.ctx = ctypes.c_void_p()
+        self.device_count = 0
+        self.values = None
+        self.nan_fill = b''
+        self.copies = []
+        self.error_reported = False
+
+    def discover(self, gpus):
+        """Hand the collector's GPUs to the plugin and allocate its slots"""
+        devices = (_PluginDevice * max(1, len(gpus)))()
+        keep = []  # Strings must outlive the call
+        for device, gpu in zip(devices, gpus):
+            sysfs_path = gpu.device_path.encode()
+            driver = gpu.driver.encode()
+            keep += [sysfs_path, driver]
+            device.index = gpu.index
+            device.vendor_id = gpu.vendor_id
+            device.device_id = gpu.device_id
+            device.pci_address = gpu.pci_address.encode()[:GPU_PLUGIN_PCI_ADDRESS_LEN - 1]
+            device.sysfs_path = sysfs_path
+            device.driver = driver
+
+        ret = self.info.discover(devices, len(gpus), ctypes.byref(self.ctx))
+        if ret < 0:
+            raise PluginError(f"{self.name}: discover failed: {os.strerror(-ret)}")
+
+        self.device_count = len(gpus)
+        slots = max(1, self.device_count * len(self.metrics))
+        self.values = (ctypes.c_double * slots)()
+        self.nan_fill = bytes((ctypes.c_double * slots)(*([math.nan] * slots)))
+
+    def map_slots(self, metric_index, metric_count):
+        """Precompute (collector slot, plugin slot) pairs for sample()"""
+        per_device = len(self.metrics)
+        self.copies = [(gpu * metric_count + metric_index[name], gpu * per_device + m)
+                       for gpu in range(self.device_count)
+                       for m, name in enumerate(self.metrics)]
+
+    def sample(self, timestamp_ns, values):
+        """Run the plugin's epoch and copy its slots into the flat values"""
+        ctypes.memmove(self.values, self.nan_fill, len(self.nan_fill))
+        ret = self.info.sample(self.ctx, timestamp_ns, self.values)
+        if ret < 0:
+            # Reported once; the plugin keeps being called and may recover
+            if not self.error_reported:
+                print(f"⚠️  Plugin {self.name}: sample failed: {os.strerror(-ret)}",
+                      file=sys.stderr)
+                self.error_reported = True
+            return
+        self.error_reported = False
+        plugin_values = self.values
+        for dst, src in self.copies:
+            values[dst] = plugin_values[src]
+
+    def close(self):
+        if self.ctx and self.info.close:
+            self.info.close(self.ctx)
+        self.ctx = ctypes.c_void_p()
+
+
+def load_plugins(paths, native_metrics):
+    """Load every plugin; metric names must be unique across all sources"""
+    plugins = []
+    taken = set(native_metrics)
+    for path in paths:
+        plugin = CollectorPlugin(path)
+        for metric in plugin.metrics:
+            if metric in taken:
+                raise PluginError(f"{plugin.name}: metric {metric} is already defined")
+            taken.add(metric)
+        plugins.append(plugin)
+    return plugins
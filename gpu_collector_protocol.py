@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""
+GPU Collector Wire Protocol
+Framing shared by gpu_collector.py and its clients, plus a small client.
+
+Every message is a frame: an 8 byte header (type u16, flags u16, payload
+length u32, little endian) followed by the payload. Control messages carry
+JSON; samples are packed binary so fan-out costs one struct.pack per
+distinct selection.
+"""
+import json
+import os
+import select
+import socket
+import struct
+from collections import deque
+
+PROTOCOL_VERSION = 1
+
+DEFAULT_SOCKET_PATH = '/run/gpu_collector.sock'
+FALLBACK_SOCKET_PATH = '/tmp/gpu_collector.sock'
+
+FRAME_HEADER = struct.Struct('<HHI')
+MAX_FRAME_SIZE = 64 * 1024 * 1024
+
+# Server -> client
+MSG_SCHEMA = 1        # JSON: GPUs, metrics and acquisition interval
+MSG_SUBSCRIBED = 2    # JSON: resolved selection, defines sample column order
+MSG_SAMPLE = 3        # Binary: SAMPLE_HEADER + float32 per selected column
+MSG_DROPPED = 4       # JSON: samples dropped for this subscriber since last report
+MSG_ERROR = 5         # JSON: {"error": message}
+MSG_BACKFILL = 6      # Binary: BACKFILL_HEADER + sample payloads, oldest first
+MSG_ANNOTATION = 7    # JSON: timestamped marker (also a recording record)
+MSG_ALERT = 8         # JSON: alert transition (also a recording record)
+MSG_TOPOLOGY = 9      # JSON: GPU topology (gpu_topology.py), resent when it changes
+MSG_IDLE = 10         # JSON: idle GPUs and daily idle fractions (gpu_idle.py)
+MSG_QUERY_RESULT = 11 # JSON: fleet quantiles (gpu_aggregator.py)
+
+# Client -> server
+MSG_SUBSCRIBE = 16    # JSON: selection, rate and slow-consumer policy
+MSG_ANNOTATE = 17     # JSON: {"text", "gpu"} marker for the collector's recording
+MSG_GET_TOPOLOGY = 18 # Empty: request MSG_TOPOLOGY now and after every change
+MSG_GET_IDLE = 19     # JSON: {"min_minutes"}, answered with MSG_IDLE
+
+# Node collector / query client -> fleet aggregator
+MSG_NODE_HELLO = 32   # JSON: node name, labels, schema and wall clock offset
+MSG_BATCH = 33        # Binary: one window's samples and per GPU and metric sketches
+MSG_QUERY = 34        # JSON: metric, quantiles, time range and grouping
+
+# Slow-consumer policies
+POLICY_DROP_OLDEST = 'drop_oldest'   # Bounded queue, oldest queued sample is dropped
+POLICY_COALESCE = 'coalesce'         # Queued samples are replaced by the newest one
+POLICIES = (POLICY_DROP_OLDEST, POLICY_COALESCE)
+
+# seq u64, timestamp_ns u64
+SAMPLE_HEADER = struct.Struct('<QQ')
+
+# Number of samples in a backfill frame
+BACKFILL_HEADER = struct.Struct('<I')
+
+
+def default_socket_path():
+    """/run when writable (root daemon), /tmp otherwise"""
+    env = os.environ.get('GPU_COLLECTOR_SOCKET')
+    if env:
+        return env
+    if os.access(os.path.dirname(DEFAULT_SOCKET_PATH), os.W_OK) or os.path.exists(DEFAULT_SOCKET_PATH):
+        return DEFAULT_SOCKET_PATH
+    return FALLBACK_SOCKET_PATH
+
+
+def encode_frame(msg_type, payload, flags=0):
+    return FRAME_HEADER.pack(msg_type, flags, len(payload)) + payload
+
+
+def encode_json(msg_type, obj):
+    return encode_frame(msg_type, json.dumps(obj, separators=(',', ':')).encode())
+
+
+def sample_struct(columns):
+    """Struct for a sample frame payload with the given column count"""
+    return struct.Struct(f'<QQ{columns}f')
+
+
+class FrameDecoder:
+    """Incremental frame parser for a non-blocking or buffered stream"""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        self.buffer += data
+
+    def frames(self):
+        """Yield (type, flags, payload) for every complete buffered frame"""
+        while len(self.buffer) >= FRAME_HEADER.size:
+            msg_type, flags, length = FRAME_HEADER.unpack_from(self.buffer)
+            if length > MAX_FRAME_SIZE:
+                raise ValueError(f"frame of {length} bytes exceeds limit")
+            end = FRAME_HEADER.size + length
+            if len(self.buffer) < end:
+                break
+            payload = bytes(self.buffer[FRAME_HEADER.size:end])
+            del self.buffer[:end]
+            yield msg_type, flags, payload
+
+
+class CollectorClient:
+    """Blocking client for the collector's Unix socket API"""
+
+    def __init__(self, path=None, timeout=None):
+        self.path = path or default_socket_path()
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.settimeout(timeout)
+        self.sock.connect(self.path)
+        self.decoder = FrameDecoder()
+        self.pending = []
+        self.selection = None
+        self.sample_format = None
+        self.backfill = []
+        self.dropped = 0
+        self.topology = None
+        self.alerts = deque(maxlen=256)  # Alert transitions pushed by the collector
+
+        msg_type, payload = self.read_message()
+        if msg_type != MSG_SCHEMA:
+            raise ConnectionError(f"expected schema, got message type {msg_type}")
+        self.schema = json.loads(payload)
+
+    def fileno(self):
+        return self.sock.fileno()
+
+    def read_message(self):
+        """Return the next (type, payload), blocking as needed"""
+        while not self.pending:
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError("collector closed the connection")
+            self.decoder.feed(data)
+            self.pending.extend(self.decoder.frames())
+        msg_type, _flags, payload = self.pending.pop(0)
+        if msg_type == MSG_ERROR:
+            raise RuntimeError(json.loads(payload).get('error', 'collector error'))
+        return msg_type, payload
+
+    def subscribe(self, gpus=None, metrics=None, rate_hz=None,
+                  policy=POLICY_DROP_OLDEST, queue=64, backfill_seconds=None):
+        """
+        Subscribe to a subset of GPUs (indices) and metrics (names) at a
+        rate in Hz. None selects everything / the acquisition rate.
+        With backfill_seconds, the collector's recent history (decimated to
+        the same rate) is fetched into self.backfill before live samples.
+        Returns the resolved selection; samples arrive in its column order.
+        """
+        request = {'gpus': gpus, 'metrics': metrics, 'rate_hz': rate_hz,
+                   'policy': policy, 'queue': queue,
+                   'backfill_seconds': backfill_seconds}
+        self.sock.sendall(encode_json(MSG_SUBSCRIBE, request))
+
+        while True:
+            msg_type, payload = self.read_message()
+            if msg_type == MSG_SUBSCRIBED:
+                break
+        self.selection = json.loads(payload)
+        self.sample_format = sample_struct(len(self.selection['columns']))
+
+        self.backfill = []
+        if backfill_seconds is not None:
+            while True:
+                msg_type, payload = self.read_message()
+                if msg_type == MSG_BACKFILL:
+                    break
+            self.backfill = self.decode_backfill(payload)
+        return self.selection
+
+    def decode_backfill(self, payload):
+        (count,) = BACKFILL_HEADER.unpack_from(payload)
+        size = self.sample_format.size
+        samples = []
+        for offset in range(BACKFILL_HEADER.size, BACKFILL_HEADER.size + count * size, size):
+            fields = self.sample_format.unpack_from(payload, offset)
+            samples.append((fields[0], fields[1], fields[2:]))
+        return samples
+
+    def read_sample(self):
+        """Block until the next sample; returns (seq, timestamp_ns, values)"""
+        while True:
+            msg_type, payload = self.read_message()
+            if msg_type == MSG_SAMPLE:
+                fields = self.sample_format.unpack(payload)
+                return fields[0], fields[1], fields[2:]
+            self._control(msg_type, payload)
+
+    def _control(self, msg_type, payload):
+        if msg_type == MSG_DROPPED:
+            self.dropped += json.loads(payload)['dropped']
+        elif msg_type == MSG_TOPOLOGY:
+            self.topology = json.loads(payload)
+        elif msg_type == MSG_ALERT:
+            self.alerts.append(json.loads(payload))
+
+    def samples(self):
+        while True:
+            yield self.read_sample()
+
+    def wait(self, timeout=None):
+        """Block until the collector sends something or timeout passes"""
+        if self.pending:
+            return True
+        readable, _, _ = select.select([self.sock], [], [], timeout)
+        return bool(readable)
+
+    def poll_samples(self):
+        """Return every sample already received, without blocking"""
+        timeout = self.sock.gettimeout()
+        self.sock.setblocking(False)
+        try:
+            while True:
+                data = self.sock.recv(65536)
+                if not data:
+                    raise ConnectionError("collector closed the connection")
+                self.decoder.feed(data)
+        except (BlockingIOError, InterruptedError):
+            pass
+        finally:
+            self.sock.settimeout(timeout)
+        self.pending.extend(self.decoder.frames())
+
+        samples = []
+        while self.pending:
+            msg_type, payload = self.read_message()
+            if msg_type == MSG_SAMPLE:
+                fields = self.sample_format.unpack(payload)
+                samples.append((fields[0], fields[1], fields[2:]))
+            else:
+                self._control(msg_type, payload)
+        return samples
+
+    def proc_data(self, values):
+        """
+        Map a sample to the flat key/value layout of /proc/gpu_monitor
+        (GPU_COUNT, GPU_<n>_NAME, GPU_<n>_<METRIC>, ...), so viewers can
+        consume collector samples with their existing parsing.
+        """
+        data = {'GPU_COUNT': str(len(self.schema['gpus'])), 'DATA_SOURCE': 'GPU_COLLECTOR'}
+        for gpu in self.schema['gpus']:
+            i = gpu['index']
+            data[f"GPU_{i}_NAME"] = gpu['name']
+            data[f"GPU_{i}_VENDOR_ID"] = f"0x{gpu['vendor_id']:04x}"
+            data[f"GPU_{i}_DEVICE_ID"] = f"0x{gpu['device_id']:04x}"
+            data[f"GPU_{i}_DRIVER"] = gpu['driver']
+        for (gpu_index, metric), value in zip(self.selection['columns'], values):
+            if value == value:  # Skip NaN: metric not provided by this GPU
+                data[f"GPU_{gpu_index}_{metric}"] = str(value)
+        return data
+
+    def _request(self, frame, reply_type):
+        """Send a request and return its reply's payload"""
+        self.sock.sendall(frame)
+        skipped = []
+        while True:
+            msg_type, payload = self.read_message()
+            if msg_type == reply_type:
+                break
+            skipped.append((msg_type, 0, payload))
+        self.pending[:0] = skipped  # Samples that arrived first are still delivered
+        return payload
+
+    def get_topology(self):
+        """
+        The collector's GPU topology (see gpu_topology.py). Afterwards
+        self.topology follows changes as samples are read.
+        """
+        self.topology = json.loads(self._request(encode_frame(MSG_GET_TOPOLOGY, b''), MSG_TOPOLOGY))
+        return self.topology
+
+    def get_idle_report(self, min_minutes=None):
+        """GPUs idle for at least min_minutes and daily idle fractions (see gpu_idle.py)"""
+        return json.loads(self._request(encode_json(MSG_GET_IDLE, {'min_minutes': min_minutes}),
+                                        MSG_IDLE))
+
+    def annotate(self, text, gpu=None):
+        """Timestamp a marker into the collector's recording (--record)"""
+        self.sock.sendall(encode_json(MSG_ANNOTATE, {'text': text, 'gpu': gpu}))
+
+    def close(self):
+        self.sock.close()
@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+"""
+GPU Columnar Export
+Writes collector sessions as Parquet or Arrow IPC for pandas/duckdb.
+
+One row per GPU per sample: typed timestamps (UTC wall clock and the raw
+CLOCK_MONOTONIC stamp), the sample sequence number, dictionary-encoded GPU
+identifiers and one float32 column per metric (null where a GPU does not
+provide the metric). Rows are buffered and written one row group at a
+time, both live (gpu_collector.py --record session.parquet) and when
+converting a recording (gpu_columnar_export.py session.gpurec).
+Annotations and alerts go to a sibling "<name>.events.<ext>" file.
+
+Needs pyarrow (pip3 install pyarrow); the collector only imports it when
+a columnar recording is requested.
+"""
+import argparse
+import json
+import math
+import os
+import sys
+import time
+from array import array
+
+from gpu_recording import RecordingReader
+
+ROW_GROUP_ROWS = 64 * 1024
+# Buffered events are written with each row group, or once this many wait
+EVENT_BATCH_ROWS = 1024
+# Event kinds, in the order of the kind column's dictionary
+EVENT_KINDS = ('annotation', 'alert')
+COLUMNAR_FORMATS = {'.parquet': 'parquet', '.arrow': 'arrow', '.feather': 'arrow'}
+
+# Arrow schema metadata key holding the collector schema (JSON)
+SCHEMA_METADATA_KEY = b'gpu_collector.schema'
+
+
+def columnar_format(path):
+    """'parquet' or 'arrow' from the file extension, None otherwise"""
+    return COLUMNAR_FORMATS.get(os.path.splitext(path)[1].lower())
+
+
+def events_path(path):
+    root, ext = os.path.splitext(path)
+    return f"{root}.events{ext}"
+
+
+def import_pyarrow():
+    try:
+        import pyarrow
+        import pyarrow.ipc
+        import pyarrow.parquet
+    except ImportError:
+        raise RuntimeError("columnar export needs pyarrow (pip3 install pyarrow)")
+    return pyarrow
+
+
+class _TableFile:
+    """Parquet or Arrow IPC file written one row group / record batch at a time"""
+
+    def __init__(self, pa, path, fmt, schema):
+        self.pa = pa
+        self.path = path
+        self.schema = schema
+        if fmt == 'parquet':
+            self.writer = pa.parquet.ParquetWriter(path, schema, compression='zstd')
+        else:
+            self.writer = pa.ipc.new_file(path, schema)
+        self.parquet = fmt == 'parquet'
+        self.rows = 0
+
+    def write(self, columns):
+        table = self.pa.Table.from_arrays(columns, schema=self.schema)
+        if self.parquet:
+            self.writer.write_table(table, row_group_size=max(1, table.num_rows))
+        else:
+            for batch in table.to_batches():
+                self.writer.write_batch(batch)
+        self.rows += table.num_rows
+
+    def close(self):
+        self.writer.close()
+
+
+class ColumnarRecorder:
+    """
+    Recorder (see gpu_recording.Recorder) producing Parquet or Arrow IPC.
+    Columns are accumulated in typed arrays and handed to pyarrow once
+    per row group, so per-sample cost is a few array appends.
+    """
+
+    def __init__(self, path, schema, fmt=None, row_group_rows=ROW_GROUP_ROWS,
+                 realtime_offset_ns=None):
+        self.pa = pa = import_pyarrow()
+        self.path = path
+        self.format = fmt or columnar_format(path) or 'parquet'
+        self.metrics = list(schema['metrics'])
+        self.gpus = schema['gpus']
+        self.row_group_rows = row_group_rows
+        self.samples = 0
+        self.rows = 0
+        if realtime_offset_ns is None:
+            realtime_offset_ns = schema.get('realtime_offset_ns',
+                                            time.time_ns() - time.monotonic_ns())
+        self.realtime_offset_ns = realtime_offset_ns
+
+        # Dictionaries are fixed for the session: GPU n is dictionary index n
+        self.gpu_ids = pa.array([gpu.get('pci_address') or str(gpu['index'])
+                                 for gpu in self.gpus], pa.string())
+        self.gpu_names = pa.array([gpu['name'] for gpu in self.gpus], pa.string())
+        self.gpu_drivers = pa.array([gpu.get('driver') or '' for gpu in self.gpus], pa.string())
+
+        dictionary = pa.dictionary(pa.int16(), pa.string())
+        header = dict(schema)
+        header['realtime_offset_ns'] = realtime_offset_ns
+        fields = [
+            pa.field('timestamp', pa.timestamp('ns', tz='UTC'), nullable=False),
+            pa.field('monotonic_ns', pa.int64(), nullable=False),
+            pa.field('seq', pa.uint64(), nullable=False),
+            pa.field('gpu_index', pa.int16(), nullable=False),
+            pa.field('gpu', dictionary, nullable=False),
+            pa.field('gpu_name', dictionary, nullable=False),
+            pa.field('driver', dictionary, nullable=False),
+        ] + [pa.field(metric.lower(), pa.float32()) for metric in self.metrics]
+        self.schema = pa.schema(fields, metadata={SCHEMA_METADATA_KEY: json.dumps(header)})
+        self.table = _TableFile(pa, path, self.format, self.schema)
+        self.events = None
+        # An IPC file allows one dictionary per field, so every batch shares this one
+        self.event_kinds = pa.array(EVENT_KINDS, pa.string())
+        self.event_rows = []
+        self._reset()
+
+    def _reset(self):
+        self.stamps = array('q')
+        self.seqs = array('Q')
+        self.gpu_column = array('h')
+        self.values = [array('f') for _ in self.metrics]
+
+    def write_sample(self, sample):
+        self.add_row_values(sample.seq, sample.timestamp_ns, sample.values)
+
+    def add_row_values(self, seq, timestamp_ns, values):
+        """Append one sample (flat values, gpu * len(metrics) + metric)"""
+        metric_count = len(self.metrics)
+        for gpu in range(len(self.gpus)):
+            self.stamps.append(timestamp_ns)
+            self.seqs.append(seq)
+            self.gpu_column.append(gpu)
+            base = gpu * metric_count
+            for m, column in enumerate(self.values):
+                column.append(values[base + m])
+        self.samples += 1
+        if len(self.stamps) >= self.row_group_rows:
+            self.flush()
+
+    def flush(self):
+        """Write buffered rows as one row group, and the buffered events"""
+        self.flush_events()
+        if not self.stamps:
+            return
+        pa = self.pa
+        monotonic = pa.array(self.stamps, pa.int64())
+        realtime = pa.array([stamp + self.realtime_offset_ns for stamp in self.stamps],
+                            pa.int64()).cast(pa.timestamp('ns', tz='UTC'))
+        indices = pa.array(self.gpu_column, pa.int16())
+        columns = [
+            realtime, monotonic,
+            pa.array(self.seqs, pa.uint64()),
+            indices,
+            pa.DictionaryArray.from_arrays(indices, self.gpu_ids),
+            pa.DictionaryArray.from_arrays(indices, self.gpu_names),
+            pa.DictionaryArray.from_arrays(indices, self.gpu_drivers),
+        ]
+        # from_pandas turns NaN (metric not provided) into null
+        columns += [pa.array(column, pa.float32(), from_pandas=True) for column in self.values]
+        self.table.write(columns)
+        self.rows += len(self.stamps)
+        self._reset()
+
+    def _event_file(self):
+        if self.events is None:
+            pa = self.pa
+            schema = pa.schema([
+                pa.field('timestamp', pa.timestamp('ns', tz='UTC'), nullable=False),
+                pa.field('monotonic_ns', pa.int64(), nullable=False),
+                pa.field('kind', pa.dictionary(pa.int8(), pa.string()), nullable=False),
+                pa.field('gpu_index', pa.int16()),
+                pa.field('text', pa.string()),
+                pa.field('metric', pa.string()),
+                pa.field('value', pa.float64()),
+                pa.field('state', pa.string()),
+            ])
+            self.events = _TableFile(pa, events_path(self.path), self.format, schema)
+        return self.events
+
+    def write_event(self, kind, record):
+        value = record.get('value')
+        self.event_rows.append((
+            record['timestamp_ns'], EVENT_KINDS.index(kind), record.get('gpu'),
+            record.get('text') or record.get('rule'), record.get('metric'),
+            None if value is None or math.isnan(value) else value, record.get('state'),
+        ))
+        if len(self.event_rows) >= EVENT_BATCH_ROWS:
+            self.flush_events()
+
+    def flush_events(self):
+        """Write buffered events as one row group / record batch"""
+        if not self.event_rows:
+            return
+        pa = self.pa
+        stamps, kinds, gpus, texts, metrics, values, states = zip(*self.event_rows)
+        self._event_file().write([
+            pa.array([stamp + self.realtime_offset_ns for stamp in stamps], pa.int64()).cast(
+                pa.timestamp('ns', tz='UTC')),
+            pa.array(stamps, pa.int64()),
+            pa.DictionaryArray.from_arrays(pa.array(kinds, pa.int8()), self.event_kinds),
+            pa.array(gpus, pa.int16()),
+            pa.array(texts, pa.string()),
+            pa.array(metrics, pa.string()),
+            pa.array(values, pa.float64()),
+            pa.array(states, pa.string()),
+        ])
+        self.event_rows = []
+
+    def annotate(self, text, gpu=None, timestamp_ns=None):
+        self.write_event('annotation', {'timestamp_ns': timestamp_ns or time.monotonic_ns(),
+                                         'text': str(text), 'gpu': gpu})
+
+    def alert(self, rule, gpu, metric, value, state, timestamp_ns=None):
+        self.write_event('alert', {'timestamp_ns': timestamp_ns or time.monotonic_ns(),
+                                    'rule': rule, 'gpu': gpu, 'metric': metric,
+                                    'value': value, 'state': state})
+
+    def close(self):
+        if self.table is None:
+            return
+        self.flush()
+        self.table.close()
+        if self.events is not None:
+            self.events.close()
+        self.table = None
+
+
+def convert(reader, path, fmt=None, row_group_rows=ROW_GROUP_ROWS):
+    """Stream a gpu_recording session into a columnar file"""
+    writer = ColumnarRecorder(path, reader.schema, fmt, row_group_rows,
+                              reader.schema.get('realtime_offset_ns'))
+    try:
+        for kind, record in reader.records():
+            if kind == 'sample':
+                writer.add_row_values(*record)
+            else:
+                writer.write_event(kind, record)
+    finally:
+        writer.close()
+    return writer
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="Export a GPU recording as Parquet or Arrow IPC")
+    parser.add_argument('recording', help="file written by gpu_collector.py --record")
+    parser.add_argument('-o', '--output', default=None,
+                        help="output file (.parquet, .arrow or .feather); default: .parquet")
+    parser.add_argument('--row-group', type=int, default=ROW_GROUP_ROWS,
+                        help="rows per row group / record batch")
+    args = parser.parse_args()
+
+    output = args.output or os.path.splitext(args.recording)[0] + '.parquet'
+    if columnar_format(output) is None:
+        print(f"❌ Unknown output format for {output} (use .parquet, .arrow or .feather)",
+              file=sys.stderr)
+        sys.exit(1)
+
+    try:
+        reader = RecordingReader(args.recording)
+        writer = convert(reader, output, row_group_rows=args.row_group)
+    except (OSError, ValueError, RuntimeError) as e:
+        print(f"❌ {e}", file=sys.stderr)
+        sys.exit(1)
+    reader.close()
+    print(f"✅ Wrote {writer.rows} rows ({writer.samples} samples × "
+          f"{len(writer.gpus)} GPUs) to {output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+"""
+GPU Derived Metrics
+A small expression language for metrics computed from other metrics, e.g.
+
+    AMBIENT_C = 25
+    MEMORY_USED_PCT = 100 * MEMORY_USED / MEMORY_TOTAL
+    WATTS_PER_BUSY_PCT = POWER_WATTS / UTILIZATION
+    TEMP_OVER_AMBIENT = TEMPERATURE - AMBIENT_C
+
+Each definition is parsed and compiled once into a tree of closures over
+flat value slots; the collector evaluates it per GPU per sample and
+publishes the result as an ordinary metric. Definitions may use metrics,
+earlier definitions, numbers, + - * / with parentheses, and the functions
+min, max, sum, avg, abs and clamp(x, lo, hi). Definitions without any
+metric are constants: they are folded into the expressions using them and
+not published. Missing inputs and division by zero yield NaN.
+"""
+import math
+import re
+
+FUNCTIONS = {
+    'min': (1, None), 'max': (1, None), 'sum': (1, None), 'avg': (1, None),
+    'abs': (1, 1), 'clamp': (3, 3),
+}
+
+_TOKEN = re.compile(r'\s*(?:(\d+\.?\d*(?:[eE][-+]?\d+)?|\.\d+(?:[eE][-+]?\d+)?)|([A-Za-z_]\w*)|(.))')
+_NAME = re.compile(r'^[A-Z][A-Z0-9_]*$')
+
+
+def _nan_min(*args):
+    return math.nan if any(a != a for a in args) else min(args)
+
+
+def _nan_max(*args):
+    return math.nan if any(a != a for a in args) else max(args)
+
+
+def _divide(a, b):
+    return a / b if b else math.nan
+
+
+def _clamp(x, lo, hi):
+    return min(max(x, lo), hi)
+
+
+_EVAL = {
+    'min': _nan_min,
+    'max': _nan_max,
+    'sum': lambda *args: sum(args),
+    'avg': lambda *args: sum(args) / len(args),
+    'abs': abs,
+    'clamp': _clamp,
+}
+_BINARY = {
+    '+': lambda a, b: a + b,
+    '-': lambda a, b: a - b,
+    '*': lambda a, b: a * b,
+    '/': _divide,
+}
+
+
+class ExpressionError(ValueError):
+    pass
+
+
+class _Parser:
+    """Recursive descent over the token list; builds ('op', ...) tuples"""
+
+    def __init__(self, text):
+        self.text = text
+        self.tokens = []
+        for number, name, other in _TOKEN.findall(text):
+            if number:
+                self.tokens.append(('num', float(number)))
+            elif name:
+                self.tokens.append(('name', name))
+            elif other.strip():
+                self.tokens.append(('op', other))
+        self.pos = 0
+
+    def peek(self):
+        return self.tokens[self.pos] if self.pos < len(self.tokens) else (None, None)
+
+    def take(self, kind=None, value=None):
+        token = self.peek()
+        if token[0] is None or (kind and token[0] != kind) or (value and token[1] != value):
+            want = value or kind or 'a token'
+            raise ExpressionError(f"expected {want} in '{self.text}'")
+        self.pos += 1
+        return token
+
+    def parse(self):
+        node = self.expression()
+        if self.pos != len(self.tokens):
+            raise ExpressionError(f"unexpected '{self.peek()[1]}' in '{self.text}'")
+        return node
+
+    def expression(self):
+        node = self.term()
+        while self.peek() in (('op', '+'), ('op', '-')):
+            op = self.take()[1]
+            node = ('bin', op, node, self.term())
+        return node
+
+    def term(self):
+        node = self.factor()
+        while self.peek() in (('op', '*'), ('op', '/')):
+            op = self.take()[1]
+            node = ('bin', op, node, self.factor())
+        return node
+
+    def factor(self):
+        kind, value = self.peek()
+        if (kind, value) == ('op', '-'):
+            self.take()
+            return ('neg', self.factor())
+        if (kind, value) == ('op', '('):
+            self.take()
+            node = self.expression()
+            self.take('op', ')')
+            return node
+        if kind == 'num':
+            self.take()
+            return ('num', value)
+        if kind == 'name':
+            self.take()
+            if self.peek() == ('op', '('):
+                return self.call(value)
+            return ('ref', value)
+        raise ExpressionError(f"unexpected end of '{self.text}'" if kind is None
+                              else f"unexpected '{value}' in '{self.text}'")
+
+    def call(self, name):
+        if name not in FUNCTIONS:
+            raise ExpressionError(f"unknown function {name}() in '{self.text}'")
+        self.take('op', '(')
+        args = [self.expression()]
+        while self.peek() == ('op', ','):
+            self.take()
+            args.append(self.expression())
+        self.take('op', ')')
+        low, high = FUNCTIONS[name]
+        if len(args) < low or (high is not None and len(args) > high):
+            raise ExpressionError(f"{name}() takes {low if low == high else f'{low}+'} "
+                                  f"argument(s) in '{self.text}'")
+        return ('call', name, args)
+
+
+class DerivedMetric:
+    """A compiled definition: evaluate(values, base) for one GPU's row"""
+
+    def __init__(self, name, text, evaluate, inputs):
+        self.name = name
+        self.text = text
+        self.evaluate = evaluate
+        self.inputs = inputs
+
+
+class DerivedMetrics:
+    """
+    Compiles definitions against a metric layout. metrics is the native
+    metric list; every published derived metric is appended after it, so
+    metric m of a GPU lives at base + m with base = gpu * total metrics.
+    """
+
+    def __init__(self, metrics):
+        self.native = list(metrics)
+        self.slots = {name: i for i, name in enumerate(self.native)}
+        self.constants = {}
+        self.derived = []
+
+    @property
+    def metrics(self):
+        return self.native + [metric.name for metric in self.derived]
+
+    def define(self, name, text):
+        name = name.strip()
+        text = text.strip()
+        if not _NAME.match(name):
+            raise ExpressionError(f"derived metric names are upper case: '{name}'")
+        if name in self.slots or name in self.constants:
+            raise ExpressionError(f"{name} is already defined")
+
+        node, inputs = self.parse(text)
+        if node[0] == 'num':
+            self.constants[name] = node[1]
+            return None
+        slot = len(self.native) + len(self.derived)
+        metric = DerivedMetric(name, text, self.compile(node), inputs)
+        self.slots[name] = slot
+        self.derived.append(metric)
+        return metric
+
+    def parse(self, text):
+        """Folded expression tree of text and the metrics it reads"""
+        inputs = set()
+        return self._fold(_Parser(text).parse(), inputs), sorted(inputs)
+
+    def compile(self, node):
+        """fn(values, base) for a tree from parse()"""
+        return self._compile(node)
+
+    def load(self, lines):
+        """'NAME = expression' lines; blank lines and # comments are skipped"""
+        for number, line in enumerate(lines, 1):
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            name, sep, text = line.partition('=')
+            if not sep:
+                raise ExpressionError(f"line {number}: expected NAME = expression")
+            self.define(name, text)
+
+    def _fold(self, node, inputs):
+        """Resolve names and fold constant subtrees"""
+        kind = node[0]
+        if kind == 'num':
+            return node
+        if kind == 'ref':
+            name = node[1]
+            if name in self.constants:
+                return ('num', self.constants[name])
+            if name not in self.slots:
+                raise ExpressionError(f"unknown metric {name}")
+            inputs.add(name)
+            return ('slot', self.slots[name])
+        if kind == 'neg':
+            inner = self._fold(node[1], inputs)
+            return ('num', -inner[1]) if inner[0] == 'num' else ('neg', inner)
+        if kind == 'bin':
+            left = self._fold(node[2], inputs)
+            right = self._fold(node[3], inputs)
+            if left[0] == 'num' and right[0] == 'num':
+                return ('num', _BINARY[node[1]](left[1], right[1]))
+            return ('bin', node[1], left, right)
+        args = [self._fold(arg, inputs) for arg in node[2]]
+        if all(arg[0] == 'num' for arg in args):
+            return ('num', _EVAL[node[1]](*[arg[1] for arg in args]))
+        return ('call', node[1], args)
+
+    def _compile(self, node):
+        """Closure tree: every node becomes fn(values, base) -> float"""
+        kind = node[0]
+        if kind == 'num':
+            constant = node[1]
+            return lambda values, base: constant
+        if kind == 'slot':
+            slot = node[1]
+            return lambda values, base: values[base + slot]
+        if kind == 'neg':
+            inner = self._compile(node[1])
+            return lambda values, base: -inner(values, base)
+        if kind == 'bin':
+            left = self._compile(node[2])
+            right = self._compile(node[3])
+            # Leaves with a constant side are the common case; skip a call for them
+            if node[3][0] == 'num':
+                constant = node[3][1]
+                if node[1] == '/':
+                    constant = 1.0 / constant if constant else math.nan
+                    return lambda values, base: left(values, base) * constant
+                op = _BINARY[node[1]]
+                return lambda values, base: op(left(values, base), constant)
+            op = _BINARY[node[1]]
+            return lambda values, base: op(left(values, base), right(values, base))
+        fn = _EVAL[node[1]]
+        args = [self._compile(arg) for arg in node[2]]
+        return lambda values, base: fn(*[arg(values, base) for arg in args])
+
+    def evaluate(self, values, gpu_count):
+        """Fill every derived slot of every GPU, in definition order"""
+        width = len(self.native) + len(self.derived)
+        first = len(self.native)
+        for base in range(0, gpu_count * width, width):
+            for offset, metric in enumerate(self.derived, first):
+                try:
+                    values[base + offset] = metric.evaluate(values, base)
+                except (OverflowError, ValueError, ZeroDivisionError):
+                    values[base + offset] = math.nan
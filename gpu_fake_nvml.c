@@ -0,0 +1,224 @@
+/*
+ * Fake NVML library
+ *
+ * Implements the part of the NVML API used by gpu_nvml.py, so the
+ * collector's NVIDIA backend can be exercised on machines without an
+ * NVIDIA GPU or driver. Devices are the PCI addresses listed in
+ * GPU_FAKE_NVML_DEVICES (comma separated, default 0000:03:00.0); their
+ * readings change on every query so consecutive samples differ.
+ *
+ * Build: make fake-nvml   (gcc -shared -fPIC -O2 -o gpu_fake_nvml.so ...)
+ * Use:   python3 gpu_collector.py --nvml ./gpu_fake_nvml.so
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAKE_MAX_DEVICES 64
+#define FAKE_BUS_ID_LEN 32
+
+// Return codes and enums, values as in nvml.h
+#define NVML_SUCCESS 0
+#define NVML_ERROR_UNINITIALIZED 1
+#define NVML_ERROR_INVALID_ARGUMENT 2
+#define NVML_ERROR_NOT_SUPPORTED 3
+#define NVML_ERROR_NOT_FOUND 6
+
+#define NVML_TEMPERATURE_GPU 0
+#define NVML_CLOCK_GRAPHICS 0
+#define NVML_CLOCK_MEM 2
+
+#define NVML_CLOCKS_THROTTLE_REASON_GPU_IDLE 0x1ULL
+#define NVML_CLOCKS_THROTTLE_REASON_SW_POWER_CAP 0x4ULL
+#define NVML_CLOCKS_THROTTLE_REASON_SW_THERMAL_SLOWDOWN 0x20ULL
+
+typedef int nvmlReturn_t;
+
+typedef struct {
+    unsigned int gpu;
+    unsigned int memory;
+} nvmlUtilization_t;
+
+typedef struct {
+    unsigned long long total;
+    unsigned long long free;
+    unsigned long long used;
+} nvmlMemory_t;
+
+struct fake_device {
+    char bus_id[FAKE_BUS_ID_LEN];
+    unsigned int index;
+    unsigned int tick;  // Advanced by every utilization query
+};
+
+typedef struct fake_device *nvmlDevice_t;
+
+static struct fake_device devices[FAKE_MAX_DEVICES];
+static unsigned int device_count;
+static int initialized;
+
+// "3:0.0" and "00000000:03:00.0" name the same device as "0000:03:00.0"
+static int parse_bus_id(const char *text, unsigned int *domain, unsigned int *bus,
+                        unsigned int *dev, unsigned int *fn)
+{
+    if (sscanf(text, "%x:%x:%x.%x", domain, bus, dev, fn) == 4)
+        return 0;
+    *domain = 0;
+    return sscanf(text, "%x:%x.%x", bus, dev, fn) == 3 ? 0 : -1;
+}
+
+nvmlReturn_t nvmlInit_v2(void)
+{
+    const char *list = getenv("GPU_FAKE_NVML_DEVICES");
+    char buffer[FAKE_MAX_DEVICES * FAKE_BUS_ID_LEN];
+    char *token, *save = NULL;
+
+    if (!list || !*list)
+        list = "0000:03:00.0";
+    snprintf(buffer, sizeof(buffer), "%s", list);
+
+    device_count = 0;
+    for (token = strtok_r(buffer, ",", &save); token && device_count < FAKE_MAX_DEVICES;
+         token = strtok_r(NULL, ",", &save)) {
+        struct fake_device *device = &devices[device_count];
+
+        snprintf(device->bus_id, sizeof(device->bus_id), "%s", token);
+        device->index = device_count;
+        device->tick = 0;
+        device_count++;
+    }
+    initialized = 1;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown(void)
+{
+    initialized = 0;
+    return NVML_SUCCESS;
+}
+
+const char *nvmlErrorString(nvmlReturn_t result)
+{
+    switch (result) {
+    case NVML_SUCCESS: return "Success";
+    case NVML_ERROR_UNINITIALIZED: return "Uninitialized";
+    case NVML_ERROR_INVALID_ARGUMENT: return "Invalid Argument";
+    case NVML_ERROR_NOT_SUPPORTED: return "Not Supported";
+    case NVML_ERROR_NOT_FOUND: return "Not Found";
+    default: return "Unknown Error";
+    }
+}
+
+nvmlReturn_t nvmlDeviceGetCount_v2(unsigned int *count)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!count)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    *count = device_count;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByPciBusId_v2(const char *bus_id, nvmlDevice_t *device)
+{
+    unsigned int want[4], have[4];
+    unsigned int i;
+
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!bus_id || !device || parse_bus_id(bus_id, &want[0], &want[1], &want[2], &want[3]))
+        return NVML_ERROR_INVALID_ARGUMENT;
+
+    for (i = 0; i < device_count; i++) {
+        if (parse_bus_id(devices[i].bus_id, &have[0], &have[1], &have[2], &have[3]))
+            continue;
+        if (!memcmp(want, have, sizeof(want))) {
+            *device = &devices[i];
+            return NVML_SUCCESS;
+        }
+    }
+    return NVML_ERROR_NOT_FOUND;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t *utilization)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !utilization)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    device->tick++;
+    utilization->gpu = (device->tick * 7 + device->index * 13) % 101;
+    utilization->memory = utilization->gpu / 2;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetMemoryInfo(nvmlDevice_t device, nvmlMemory_t *memory)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !memory)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    memory->total = 24ULL << 30;
+    memory->used = (1ULL << 30) + ((unsigned long long)(device->tick % 16) << 30);
+    memory->free = memory->total - memory->used;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, int sensor, unsigned int *temp)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !temp)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    if (sensor != NVML_TEMPERATURE_GPU)
+        return NVML_ERROR_NOT_SUPPORTED;
+    *temp = 40 + (device->tick * 3 + device->index) % 45;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int *power_mw)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !power_mw)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    *power_mw = 60000 + ((device->tick * 7 + device->index * 13) % 101) * 2500;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetClockInfo(nvmlDevice_t device, int type, unsigned int *clock_mhz)
+{
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !clock_mhz)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    if (type == NVML_CLOCK_GRAPHICS)
+        *clock_mhz = 210 + (device->tick % 10) * 180;
+    else if (type == NVML_CLOCK_MEM)
+        *clock_mhz = 9501;
+    else
+        return NVML_ERROR_NOT_SUPPORTED;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetCurrentClocksThrottleReasons(nvmlDevice_t device,
+                                                       unsigned long long *reasons)
+{
+    unsigned int busy, temp;
+
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!device || !reasons)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    busy = (device->tick * 7 + device->index * 13) % 101;
+    temp = 40 + (device->tick * 3 + device->index) % 45;
+
+    *reasons = 0;
+    if (busy < 5)
+        *reasons |= NVML_CLOCKS_THROTTLE_REASON_GPU_IDLE;
+    if (busy > 90)
+        *reasons |= NVML_CLOCKS_THROTTLE_REASON_SW_POWER_CAP;
+    if (temp > 80)
+        *reasons |= NVML_CLOCKS_THROTTLE_REASON_SW_THERMAL_SLOWDOWN;
+    return NVML_SUCCESS;
+}
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+GPU Idle Report
+Finds GPUs that sit idle inside long-running allocations. Samples are
+rolled up into fixed windows (a minute by default) holding each GPU's peak
+of the threshold metrics; a GPU is idle for a window when every peak stays
+under its threshold, so a single busy sample breaks a streak but a noisy
+idle one does not make it. Per sample this only updates the peaks; streaks
+and per-day idle/observed seconds advance once per window, never by
+rescanning history.
+
+The collector runs an IdleTracker on its samples and answers MSG_GET_IDLE;
+this script prints that report, or computes one from a recording:
+    python3 gpu_idle.py                       # ask the running collector
+    python3 gpu_idle.py --recording s.gpurec  # offline
+"""
+import argparse
+import math
+import sys
+import time
+
+# Defaults for the collector's --idle-* options
+IDLE_UTILIZATION = 5.0   # % busy
+IDLE_WINDOW = 60.0       # seconds per rollup window
+IDLE_MINUTES = 10.0      # streak length that lists (and alerts on) a GPU
+
+# Days of idle fractions kept
+IDLE_DAYS = 7
+
+IDLE_RULE = 'gpu_idle'
+
+
+class IdleTracker:
+    """Idle streaks and daily idle fractions per GPU, from per-window peaks"""
+
+    def __init__(self, gpu_count, metrics, thresholds, window_seconds=IDLE_WINDOW,
+                 idle_minutes=IDLE_MINUTES, realtime_offset_ns=None, on_transition=None):
+        self.gpu_count = gpu_count
+        self.metric_count = len(metrics)
+        self.thresholds = {metric: limit for metric, limit in thresholds.items()
+                           if limit is not None and metric in metrics}
+        if not self.thresholds:
+            raise ValueError("no idle threshold applies to the collector's metrics")
+        self.metric_names = list(self.thresholds)
+        self.limits = [self.thresholds[metric] for metric in self.metric_names]
+        self.offsets = [metrics.index(metric) for metric in self.metric_names]
+
+        self.window_ns = int(window_seconds * 1e9)
+        self.idle_ns = int(idle_minutes * 60e9)
+        if realtime_offset_ns is None:
+            realtime_offset_ns = time.time_ns() - time.monotonic_ns()
+        self.realtime_offset_ns = realtime_offset_ns
+        self.on_transition = on_transition
+
+        self.window_start = None
+        self.peaks = self._empty_peaks()
+        self.idle_since = [None] * gpu_count   # Start of the current streak
+        self.alerted = [False] * gpu_count
+        self.days = {}                         # date -> [[observed_ns, idle_ns] per GPU]
+
+    def _empty_peaks(self):
+        return [[-math.inf] * self.gpu_count for _ in self.metric_names]
+
+    def add(self, timestamp_ns, values):
+        """Fold one sample (flat values, gpu * metric_count + metric) into the window"""
+        if self.window_start is None:
+            self.window_start = timestamp_ns
+        elif timestamp_ns >= self.window_start + self.window_ns:
+            self._close_window(timestamp_ns)
+
+        stride = self.metric_count
+        for peaks, offset in zip(self.peaks, self.offsets):
+            for gpu, value in enumerate(values[offset::stride]):
+                if value > peaks[gpu]:  # NaN never raises the peak
+                    peaks[gpu] = value
+
+    def _close_window(self, timestamp_ns):
+        start = self.window_start
+        end = start + self.window_ns
+        # Samples stopped (suspend, collector stall): streaks do not span the gap
+        gap = timestamp_ns >= end + self.window_ns
+        date = self.date(start)
+        day = self.days.get(date)
+        if day is None:
+            day = self.days[date] = [[0, 0] for _ in range(self.gpu_count)]
+            for old in sorted(self.days)[:-IDLE_DAYS]:
+                del self.days[old]
+
+        for gpu in range(self.gpu_count):
+            peaks = [peaks[gpu] for peaks in self.peaks]
+            if any(peak == -math.inf for peak in peaks):
+                idle = None  # Not observed in this window
+            else:
+                idle = all(peak < limit for peak, limit in zip(peaks, self.limits))
+                day[gpu][0] += self.window_ns
+                if idle:
+                    day[gpu][1] += self.window_ns
+
+            if idle:
+                if self.idle_since[gpu] is None:
+                    self.idle_since[gpu] = start
+                if not self.alerted[gpu] and end - self.idle_since[gpu] >= self.idle_ns:
+                    self.alerted[gpu] = True
+                    self._transition(gpu, 'firing', peaks[0], end)
+            if not idle or gap:
+                if self.alerted[gpu]:
+                    self._transition(gpu, 'resolved', peaks[0], end)
+                self.idle_since[gpu] = None
+                self.alerted[gpu] = False
+
+        self.window_start = timestamp_ns if gap else end
+        self.peaks = self._empty_peaks()
+
+    def _transition(self, gpu, state, value, timestamp_ns):
+        if self.on_transition is not None:
+            self.on_transition(gpu, self.metric_names[0],
+                               None if value == -math.inf else value, state, timestamp_ns)
+
+    def date(self, timestamp_ns):
+        """Local calendar day of a monotonic timestamp"""
+        return time.strftime('%Y-%m-%d', time.localtime((timestamp_ns + self.realtime_offset_ns) / 1e9))
+
+    def idle_seconds(self, gpu):
+        """Length of the GPU's current idle streak, up to the last closed window"""
+        since = self.idle_since[gpu]
+        return 0.0 if since is None else (self.window_start - since) / 1e9
+
+    def report(self, min_minutes=None):
+        """GPUs idle for at least min_minutes (default: the alert length) and daily fractions"""
+        min_seconds = self.idle_ns / 1e9 if min_minutes is None else min_minutes * 60
+        idle = [{'gpu': gpu, 'idle_seconds': self.idle_seconds(gpu),
+                 'since_ns': self.idle_since[gpu]}
+                for gpu in range(self.gpu_count)
+                if self.idle_since[gpu] is not None and self.idle_seconds(gpu) >= min_seconds]
+        idle.sort(key=lambda entry: -entry['idle_seconds'])
+
+        daily = []
+        for date in sorted(self.days):
+            gpus = [{'gpu': gpu, 'observed_seconds': observed / 1e9,
+                     'idle_seconds': idle_ns / 1e9,
+                     'idle_fraction': idle_ns / observed if observed else None}
+                    for gpu, (observed, idle_ns) in enumerate(self.days[date])]
+            daily.append({'date': date, 'gpus': gpus})
+
+        return {'thresholds': self.thresholds, 'window_seconds': self.window_ns / 1e9,
+                'min_minutes': min_seconds / 60, 'idle': idle, 'daily': daily}
+
+
+def format_report(report, names=None):
+    """Human-readable idle list and daily table"""
+    def name(gpu):
+        return f"GPU {gpu}" + (f" ({names[gpu]})" if names and gpu < len(names) else "")
+
+    limits = ', '.join(f"{metric} < {limit:g}" for metric, limit in report['thresholds'].items())
+    lines = [f"💤 Idle ({limits}, {report['window_seconds']:g}s windows) "
+             f"for {report['min_minutes']:g}+ minutes:"]
+    if not report['idle']:
+        lines.append("   none")
+    for entry in report['idle']:
+        lines.append(f"   {name(entry['gpu'])}: {entry['idle_seconds'] / 60:.0f} min")
+
+    for day in report['daily']:
+        lines.append("")
+        lines.append(f"📅 {day['date']}  {'observed':>10} {'idle':>10} {'idle %':>7}")
+        for entry in day['gpus']:
+            fraction = entry['idle_fraction']
+            lines.append(f"   {'GPU ' + str(entry['gpu']):<8} "
+                         f"{entry['observed_seconds'] / 3600:9.1f}h {entry['idle_seconds'] / 3600:9.1f}h "
+                         + (f"{fraction * 100:6.1f}%" if fraction is not None else f"{'—':>7}"))
+    return '\n'.join(lines)
+
+
+def replay(path, thresholds, window_seconds, idle_minutes):
+    """IdleTracker over a recording, as the collector would have run it"""
+    from gpu_recording import RecordingReader
+
+    reader = RecordingReader(path)
+    try:
+        tracker = IdleTracker(len(reader.gpus), reader.metrics, thresholds, window_seconds,
+                              idle_minutes, reader.schema.get('realtime_offset_ns'))
+        last_ns = None
+        for kind, record in reader.records():
+            if kind == 'sample':
+                last_ns = record[1]
+                tracker.add(last_ns, record[2])
+        if last_ns is not None:
+            tracker.add(last_ns + tracker.window_ns, [])  # Close the final window
+        return tracker.report(), [gpu['name'] for gpu in reader.gpus]
+    finally:
+        reader.close()
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="GPU idle report")
+    parser.add_argument('--recording', default=None, metavar='FILE',
+                        help="compute the report from a recording instead of the collector")
+    parser.add_argument('--socket', default=None, help="collector socket")
+    parser.add_argument('--minutes', type=float, default=None,
+                        help="list GPUs idle at least this long (default: collector's --idle-minutes)")
+    parser.add_argument('--util', type=float, default=IDLE_UTILIZATION, help="with --recording")
+    parser.add_argument('--power', type=float, default=None, help="with --recording")
+    parser.add_argument('--window', type=float, default=IDLE_WINDOW, help="with --recording")
+    parser.add_argument('--json', action='store_true', help="print the report as JSON")
+    args = parser.parse_args()
+
+    try:
+        if args.recording:
+            thresholds = {'UTILIZATION': args.util, 'POWER_WATTS': args.power}
+            report, names = replay(args.recording, thresholds, args.window,
+                                   IDLE_MINUTES if args.minutes is None else args.minutes)
+        else:
+            from gpu_collector_protocol import CollectorClient
+            client = CollectorClient(args.socket, timeout=5)
+            report = client.get_idle_report(args.minutes)
+            names = [gpu['name'] for gpu in client.schema['gpus']]
+            client.close()
+    except (OSError, ValueError, RuntimeError, ConnectionError) as e:
+        print(f"❌ {e}", file=sys.stderr)
+        sys.exit(1)
+
+    if args.json:
+        import json
+        print(json.dumps(report, indent=2))
+    else:
+        print(format_report(report, names))
+
+
+if __name__ == "__main__":
+    main()
@@ -6,17 +6,56 @@
 #include <linux/seq_file.h>
 #include <linux/pci.h>
 #include <linux/delay.h>
-#include <linux/timer.h>
+#include <linux/workqueue.h>
 #include <linux/jiffies.h>
 #include <linux/fs.h>
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/stat.h>
+#include <linux/suspend.h>
+#include <linux/pm_runtime.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/math64.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
 
 #define PROC_NAME "gpu_monitor"
+#define HISTORY_PROC_NAME "gpu_monitor_history"
 #define MAX_PATH_LEN 512
 #define MAX_BUFFER_SIZE 256
+#define MAX_IRQ_BUFFER_SIZE 4096
 #define MAX_GPUS 4
+#define MAX_VFS_PER_GPU 64
+
+// History: a ring of fixed-size chunks of delta-encoded samples. Every
+// chunk starts with a keyframe, so the oldest can be dropped whole. At
+// 5-15 bytes per sample this holds several hours at the 3 second update
+// interval, or an hour at one sample per second.
+#define HISTORY_CHUNK_SIZE 1024
+#define HISTORY_CHUNKS 40
+// Largest encoded sample: timestamp, mask and every field changed
+#define HISTORY_MAX_RECORD 64
+
+// Sampling lanes. The sampler ticks every SAMPLE_TICK_MS and each pass reads
+// only the metrics whose lane is due: fast ones every tick, normal ones on
+// the published 3 second sample (counters, history, poll wakeups), slow
+// ones every 30 seconds, static ones once and again after a gap.
+#define LANE_STATIC  0x1
+#define LANE_SLOW    0x2
+#define LANE_NORMAL  0x4
+#define LANE_FAST    0x8
+#define LANES_ALL    (LANE_STATIC | LANE_SLOW | LANE_NORMAL | LANE_FAST)
+
+#define SAMPLE_TICK_MS 300
+#define NORMAL_TICKS 10     // 3 s
+#define SLOW_TICKS 100      // 30 s
+
+// Sample flags recorded in history
+#define SAMPLE_FLAG_GAP         0x1  // Discontinuity before this sample (system suspend)
+#define SAMPLE_FLAG_RUNTIME_PM  0x2  // Discontinuity before this sample (GPU runtime suspend)
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("GPU Hardware Monitor");
@@ -28,6 +67,136 @@ MODULE_VERSION("2.0");
 #define PCI_VENDOR_ID_AMD       0x1002
 #define PCI_VENDOR_ID_INTEL     0x8086
 
+// Directly read metrics, for lane assignment
+enum gpu_metric {
+    M_MEMORY_TOTAL,
+    M_MEMORY_USED,
+    M_TEMPERATURE,
+    M_CLOCK,
+    M_POWER,
+    M_UTILIZATION,
+    M_FAN,
+    GPU_METRICS
+};
+
+static const u8 metric_lane[GPU_METRICS] = {
+    [M_MEMORY_TOTAL] = LANE_STATIC,
+    [M_MEMORY_USED]  = LANE_NORMAL,
+    [M_TEMPERATURE]  = LANE_NORMAL,   // Thermal mass: seconds, not milliseconds
+    [M_CLOCK]        = LANE_NORMAL,
+    [M_POWER]        = LANE_FAST,     // Follows load within milliseconds
+    [M_UTILIZATION]  = LANE_NORMAL,
+    [M_FAN]          = LANE_SLOW,     // Fan curves react over tens of seconds
+};
+
+static const char * const metric_names[GPU_METRICS] = {
+    [M_MEMORY_TOTAL] = "MEMORY_TOTAL",
+    [M_MEMORY_USED]  = "MEMORY_USED",
+    [M_TEMPERATURE]  = "TEMPERATURE",
+    [M_CLOCK]        = "CLOCK_MHZ",
+    [M_POWER]        = "POWER_WATTS",
+    [M_UTILIZATION]  = "UTILIZATION",
+    [M_FAN]          = "FAN_RPM",
+};
+
+// Instantaneous snapshots that alias badly at the sample rate. Where the
+// GPU has them, they are read every fast tick and reduced into each
+// published sample.
+static const bool metric_oversampled[GPU_METRICS] = {
+    [M_CLOCK]       = true,   // rps_cur_freq_mhz
+    [M_UTILIZATION] = true,   // gpu_busy_percent
+};
+
+// Reduction of oversampled reads into the published value
+enum decimation {
+    DECIMATE_OFF,
+    DECIMATE_MEAN,
+    DECIMATE_MAX,
+    DECIMATE_TWA,   // Time-weighted: each read holds until the next
+};
+
+static const char * const decimation_names[] = {
+    [DECIMATE_OFF]  = "off",
+    [DECIMATE_MEAN] = "mean",
+    [DECIMATE_MAX]  = "max",
+    [DECIMATE_TWA]  = "twa",
+};
+
+static char *decimation = "twa";
+module_param(decimation, charp, 0444);
+MODULE_PARM_DESC(decimation, "Oversampled busy %/GPU clock reduction: twa (default), mean, max or off");
+
+static enum decimation decimation_mode = DECIMATE_TWA;
+
+// Reads of one oversampled metric since the last published sample
+struct gpu_decimator {
+    u64 sum;            // Of reads, for the mean
+    u64 weighted;       // Of value x nanoseconds held, for the time-weighted average
+    u64 start_ns;       // Interval start
+    u64 last_ns;        // Time of the last read, 0: none since a reset
+    u32 last;
+    u32 max;
+    u32 count;
+    u32 published_max;  // Max of the last published interval
+};
+
+// Monotonic hardware counter with continuity across resets.
+// The exported total is offset + raw; offset absorbs counter resets
+// caused by suspend or device power-down.
+struct gpu_counter {
+    u64 raw;        // Last raw hardware value
+    u64 offset;     // Accumulated value lost to hardware resets
+    u64 stamp_ns;   // Boottime of the last raw read
+    bool primed;    // raw holds a real reading
+    bool valid;     // raw/stamp_ns form a usable rate baseline
+};
+
+// History sample fields. The index is the field's bit in the changed-field
+// mask, so the fields that change on most samples share the mask's first byte.
+enum history_field {
+    HF_POWER_WATTS,
+    HF_UTILIZATION,
+    HF_IRQ_RATE,
+    HF_ENERGY_POWER_MW,
+    HF_CLOCK_MHZ,
+    HF_RC6_PCT,
+    HF_TEMPERATURE,
+    HF_MEMORY_USED,
+    HF_FAN_RPM,
+    HF_FLAGS,
+    HISTORY_FIELDS
+};
+
+// One history entry, as pushed and as decoded
+struct gpu_sample {
+    u64 timestamp_ns;   // Boottime, so suspend gaps are visible
+    u32 field[HISTORY_FIELDS];
+};
+
+// A keyframe (every field as a varint; its timestamp in key_ns) followed
+// by delta records: zigzag varint of the change in sampling interval, a
+// varint mask of changed fields, then a zigzag varint delta per changed field
+struct history_chunk {
+    u64 key_ns;
+    u16 used;           // Encoded bytes
+    u16 count;          // Samples, the keyframe included
+    u8 data[HISTORY_CHUNK_SIZE];
+};
+
+// One SR-IOV virtual function, sampled in its physical function's pass.
+// Drivers expose little per-VF telemetry on the host; what is generic is
+// the binding (vfio-pci: assigned to a VM), runtime PM and interrupts.
+struct gpu_vf {
+    struct pci_dev *pdev;       // Referenced until the next enumeration
+    int vf_id;                  // Index as in the PF's virtfn<N> links
+    char pci_address[16];
+    char driver[64];
+    bool runtime_suspended;
+    bool irq_available;
+    struct gpu_counter irq_count;
+    u32 irq_rate;
+};
+
 // GPU monitoring structure
 struct gpu_monitor {
     struct pci_dev *pdev;
@@ -40,6 +209,7 @@ struct gpu_monitor {
     char hwmon_path[MAX_PATH_LEN];
     char drm_path[MAX_PATH_LEN];
     char pci_path[MAX_PATH_LEN];
+    char rc6_path[MAX_PATH_LEN];
     
     // Current metrics
     u32 memory_used_mb;
@@ -50,6 +220,21 @@ struct gpu_monitor {
     u32 utilization_pct;
     u32 fan_rpm;
     
+    // Lane of each metric on this GPU; oversampled ones are in the fast lane
+    u8 lane[GPU_METRICS];
+    u32 oversampled;          // Bit per enum gpu_metric
+    struct gpu_decimator decimators[GPU_METRICS];
+    
+    // Counter-derived rates (zero on the first sample after a gap)
+    u32 energy_power_mw;
+    u32 rc6_pct;
+    u32 irq_rate;
+    
+    // Hardware counters
+    struct gpu_counter energy_uj;
+    struct gpu_counter rc6_ms;
+    struct gpu_counter irq_count;
+    
     // Status flags
     bool hwmon_available;
     bool drm_available;
@@ -59,15 +244,62 @@ struct gpu_monitor {
     bool clock_available;
     bool util_available;
     bool fan_available;
+    bool energy_available;
+    bool rc6_available;
+    bool irq_available;
+    
+    // Power management state
+    bool runtime_suspended;   // Skipped the last sample: device was runtime suspended
+    u32 pending_flags;        // Flags for the next history sample
+    u32 gap_count;
+    
+    // SR-IOV: slots for up to sriov_totalvfs VFs, bound to the enabled ones
+    struct gpu_vf *vfs;
+    int vf_capacity;
+    int vf_count;             // Slots in use
+    int vf_enabled;           // pci_num_vf() when the slots were bound
+    int vf_missing;           // Enabled VFs not found on the bus yet
+    
+    // History chunk ring
+    struct history_chunk *history;
+    unsigned int history_first;    // Oldest chunk
+    unsigned int history_chunks;   // Chunks in use
+    unsigned int history_count;    // Samples in those chunks
+    struct gpu_sample history_last;   // Delta base for the next sample
+    u64 history_last_dt;              // Interval base, 0 after a keyframe
     
     // Update timestamp
     unsigned long last_update;
 };
 
+static inline bool lane_due(const struct gpu_monitor *gpu, u8 lanes, enum gpu_metric metric)
+{
+    return lanes & gpu->lane[metric];
+}
+
 static struct gpu_monitor *gpus[MAX_GPUS];
 static int gpu_count = 0;
 static struct proc_dir_entry *proc_entry;
-static struct timer_list update_timer;
+static struct proc_dir_entry *history_proc_entry;
+// Sampling runs from a workqueue: sysfs reads open files and may sleep
+static struct delayed_work update_work;
+static DEFINE_MUTEX(history_lock);
+// Held while VF slots are rebound or read
+static DEFINE_MUTEX(vf_lock);
+
+// Bumped after every sampling pass; readers of /proc/gpu_monitor can
+// poll() for it instead of re-reading on a timer
+static atomic64_t sample_seq = ATOMIC64_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(sample_wait);
+
+// Sampler ticks since load or the last resume, for lane scheduling
+static unsigned int sample_tick;
+
+// System suspend state
+static bool sampling_paused;
+static u32 suspend_count;
+static u64 suspend_start_ns;
+static u64 suspended_total_ns;
 
 // Utility function to safely read a sysfs file
 static int read_sysfs_file(const char *path, char *buffer, size_t size)
@@ -232,6 +464,10 @@ static void init_gpu_paths(struct gpu_monitor *gpu)
         // Check fan
         snprintf(test_path, sizeof(test_path), "%s/fan1_input", gpu->hwmon_path);
         gpu->fan_available = path_exists(test_path);
+        
+        // Check energy counter
+        snprintf(test_path, sizeof(test_path), "%s/energy1_input", gpu->hwmon_path);
+        gpu->energy_available = path_exists(test_path);
     }
     
     if (gpu->drm_available) {
@@ -249,15 +485,60 @@ static void init_gpu_paths(struct gpu_monitor *gpu)
             snprintf(test_path, sizeof(test_path), "%s/gt_cur_freq_mhz", gpu->drm_path);
         }
         gpu->clock_available = path_exists(test_path);
+        
+        // Check RC6 residency counter (Intel specific)
+        snprintf(gpu->rc6_path, sizeof(gpu->rc6_path), "%s/gt/gt0/rc6_residency_ms", gpu->drm_path);
+        if (!path_exists(gpu->rc6_path)) {
+            snprintf(gpu->rc6_path, sizeof(gpu->rc6_path), "%s/power/rc6_residency_ms", gpu->drm_path);
+        }
+        gpu->rc6_available = path_exists(gpu->rc6_path);
+    }
+    
+    // Check interrupt counter
+    if (gpu->pdev->irq) {
+        snprintf(test_path, sizeof(test_path), "/sys/kernel/irq/%u/per_cpu_count", gpu->pdev->irq);
+        gpu->irq_available = path_exists(test_path);
     }
     
-    pr_info("GPU Monitor: Capabilities for %s - Temp:%d Power:%d Fan:%d Memory:%d Util:%d Clock:%d\n",
+    pr_info("GPU Monitor: Capabilities for %s - Temp:%d Power:%d Fan:%d Memory:%d Util:%d Clock:%d Energy:%d RC6:%d IRQ:%d\n",
            gpu->name, gpu->temp_available, gpu->power_available, gpu->fan_available,
-           gpu->memory_info_available, gpu->util_available, gpu->clock_available);
+           gpu->memory_info_available, gpu->util_available, gpu->clock_available,
+           gpu->energy_available, gpu->rc6_available, gpu->irq_available);
+}
+
+// Assign lanes. Simulated values stay once per sample; oversampled
+// metrics join the fast lane on GPUs that have a real attribute for them.
+static void init_gpu_lanes(struct gpu_monitor *gpu)
+{
+    int m;
+    
+    for (m = 0; m < GPU_METRICS; m++)
+        gpu->lane[m] = metric_lane[m];
+    
+    // The Intel reader has no power or VRAM size source and simulates them
+    // once per published sample; in their own lanes they would read 0
+    // between samples
+    if (gpu->vendor_id == PCI_VENDOR_ID_INTEL) {
+        gpu->lane[M_POWER] = LANE_NORMAL;
+        gpu->lane[M_MEMORY_TOTAL] = LANE_NORMAL;
+    }
+    
+    if (decimation_mode == DECIMATE_OFF)
+        return;
+    
+    for (m = 0; m < GPU_METRICS; m++) {
+        bool available = (m == M_CLOCK && gpu->clock_available) ||
+                         (m == M_UTILIZATION && gpu->util_available);
+        
+        if (metric_oversampled[m] && available) {
+            gpu->lane[m] = LANE_FAST;
+            gpu->oversampled |= BIT(m);
+        }
+    }
 }
 
-// Read NVIDIA GPU data
-static void read_nvidia_data(struct gpu_monitor *gpu)
+// Read NVIDIA GPU data of the due lanes
+static void read_nvidia_data(struct gpu_monitor *gpu, u8 lanes)
 {
     char buffer[MAX_BUFFER_SIZE];
     char path[MAX_PATH_LEN];
@@ -267,7 +548,7 @@ static void read_nvidia_data(struct gpu_monitor *gpu)
         return;
         
     // Temperature
-    if (gpu->temp_available) {
+    if (gpu->temp_available && lane_due(gpu, lanes, M_TEMPERATURE)) {
         snprintf(path, sizeof(path), "%s/temp1_input", gpu->hwmon_path);
         if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
             if (kstrtol(buffer, 10, &value) == 0) {
@@ -277,7 +558,7 @@ static void read_nvidia_data(struct gpu_monitor *gpu)
     }
     
     // Power
-    if (gpu->power_available) {
+    if (gpu->power_available && lane_due(gpu, lanes, M_POWER)) {
         snprintf(path, sizeof(path), "%s/power1_average", gpu->hwmon_path);
         if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
             if (kstrtol(buffer, 10, &value) == 0) {
@@ -287,7 +568,7 @@ static void read_nvidia_data(struct gpu_monitor *gpu)
     }
     
     // Fan speed
-    if (gpu->fan_available) {
+    if (gpu->fan_available && lane_due(gpu, lanes, M_FAN)) {
         snprintf(path, sizeof(path), "%s/fan1_input", gpu->hwmon_path);
         if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
             if (kstrtol(buffer, 10, &value) == 0) {
@@ -297,8 +578,8 @@ static void read_nvidia_data(struct gpu_monitor *gpu)
     }
 }
 
-// Read AMD GPU data
-static void read_amd_data(struct gpu_monitor *gpu)
+// Read AMD GPU data of the due lanes
+static void read_amd_data(struct gpu_monitor *gpu, u8 lanes)
 {
     char buffer[MAX_BUFFER_SIZE];
     char path[MAX_PATH_LEN];
@@ -307,7 +588,7 @@ static void read_amd_data(struct gpu_monitor *gpu)
     // Read from hwmon if available
     if (gpu->hwmon_available) {
         // Temperature
-        if (gpu->temp_available) {
+        if (gpu->temp_available && lane_due(gpu, lanes, M_TEMPERATURE)) {
             snprintf(path, sizeof(path), "%s/temp1_input", gpu->hwmon_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
@@ -317,7 +598,7 @@ static void read_amd_data(struct gpu_monitor *gpu)
         }
         
         // Power
-        if (gpu->power_available) {
+        if (gpu->power_available && lane_due(gpu, lanes, M_POWER)) {
             snprintf(path, sizeof(path), "%s/power1_average", gpu->hwmon_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
@@ -327,7 +608,7 @@ static void read_amd_data(struct gpu_monitor *gpu)
         }
         
         // Fan
-        if (gpu->fan_available) {
+        if (gpu->fan_available && lane_due(gpu, lanes, M_FAN)) {
             snprintf(path, sizeof(path), "%s/fan1_input", gpu->hwmon_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
@@ -340,14 +621,17 @@ static void read_amd_data(struct gpu_monitor *gpu)
     // Read from DRM interface
     if (gpu->drm_available) {
         // Memory usage
-        if (gpu->memory_info_available) {
+        if (gpu->memory_info_available && lane_due(gpu, lanes, M_MEMORY_USED)) {
             snprintf(path, sizeof(path), "%s/device/mem_info_vram_used", gpu->drm_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
                     gpu->memory_used_mb = value / (1024 * 1024);
                 }
             }
-            
+        }
+        
+        // VRAM size never changes while the device is bound
+        if (gpu->memory_info_available && lane_due(gpu, lanes, M_MEMORY_TOTAL)) {
             snprintf(path, sizeof(path), "%s/device/mem_info_vram_total", gpu->drm_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
@@ -357,7 +641,7 @@ static void read_amd_data(struct gpu_monitor *gpu)
         }
         
         // GPU utilization
-        if (gpu->util_available) {
+        if (gpu->util_available && lane_due(gpu, lanes, M_UTILIZATION)) {
             snprintf(path, sizeof(path), "%s/device/gpu_busy_percent", gpu->drm_path);
             if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
                 if (kstrtol(buffer, 10, &value) == 0) {
@@ -368,20 +652,16 @@ static void read_amd_data(struct gpu_monitor *gpu)
     }
 }
 
-// Read Intel GPU data
-static void read_intel_data(struct gpu_monitor *gpu)
+// Read Intel GPU data of the due lanes
+static void read_intel_data(struct gpu_monitor *gpu, u8 lanes)
 {
     char buffer[MAX_BUFFER_SIZE];
     char path[MAX_PATH_LEN];
     long value;
     
-    // Intel integrated graphics share system memory
-    gpu->memory_used_mb = 0;  // Not directly measurable
-    gpu->memory_total_mb = 0; // Shared with system
-    
     // Try to read CPU temperature as a proxy for integrated GPU temperature
     // Intel integrated GPUs typically don't have separate temperature sensors
-    if (path_exists("/sys/class/hwmon/hwmon2/temp1_input")) {
+    if (lane_due(gpu, lanes, M_TEMPERATURE) && path_exists("/sys/class/hwmon/hwmon2/temp1_input")) {
         if (read_sysfs_file("/sys/class/hwmon/hwmon2/temp1_input", buffer, sizeof(buffer)) == 0) {
             if (kstrtol(buffer, 10, &value) == 0) {
                 // Use CPU temp as approximation, usually GPU is 5-10°C higher
@@ -391,7 +671,7 @@ static void read_intel_data(struct gpu_monitor *gpu)
     }
     
     // Try to read GPU frequency
-    if (gpu->drm_available) {
+    if (gpu->drm_available && lane_due(gpu, lanes, M_CLOCK)) {
         // Try multiple possible frequency paths for Intel GPUs
         snprintf(path, sizeof(path), "%s/gt/gt0/rps_cur_freq_mhz", gpu->drm_path);
         if (read_sysfs_file(path, buffer, sizeof(buffer)) == 0) {
@@ -417,6 +697,10 @@ static void read_intel_data(struct gpu_monitor *gpu)
         }
     }
     
+    // The simulated values below advance once per published sample
+    if (!(lanes & LANE_NORMAL))
+        return;
+    
     // Simulate some realistic data for demonstration purposes
     // In a real scenario, you'd need more sophisticated monitoring
     static int counter = 0;
@@ -425,7 +709,8 @@ static void read_intel_data(struct gpu_monitor *gpu)
     // Simulate varying utilization (0-100%)
     gpu->utilization_pct = (counter * 7) % 101;
     
-    // Simulate varying memory usage (512-2048 MB)
+    // Simulate varying memory usage (512-2048 MB); integrated graphics
+    // share system memory, so neither value is directly measurable
     gpu->memory_used_mb = 512 + ((counter * 13) % 1536);
     gpu->memory_total_mb = 4096; // Typical shared memory allocation
     
@@ -443,32 +728,613 @@ static void read_intel_data(struct gpu_monitor *gpu)
     }
 }
 
-// Update all GPU data
-static void update_gpu_data(struct gpu_monitor *gpu)
+// Read an unsigned 64-bit value from a sysfs file
+static bool read_u64_file(const char *path, u64 *value)
 {
-    if (!gpu || !gpu->pdev)
+    char buffer[MAX_BUFFER_SIZE];
+    
+    if (read_sysfs_file(path, buffer, sizeof(buffer)) != 0)
+        return false;
+    return kstrtou64(buffer, 10, value) == 0;
+}
+
+// Read cumulative energy in microjoules from hwmon
+static bool read_energy_counter(struct gpu_monitor *gpu, u64 *value)
+{
+    char path[MAX_PATH_LEN];
+    
+    snprintf(path, sizeof(path), "%s/energy1_input", gpu->hwmon_path);
+    return read_u64_file(path, value);
+}
+
+// Read cumulative RC6 (idle) residency in milliseconds
+static bool read_rc6_counter(struct gpu_monitor *gpu, u64 *value)
+{
+    return read_u64_file(gpu->rc6_path, value);
+}
+
+// Sum the per-CPU interrupt counts of an IRQ line
+static bool read_irq_line(unsigned int irq, u64 *value)
+{
+    char path[MAX_PATH_LEN];
+    char *buffer, *cur, *tok;
+    u64 count, total = 0;
+    bool ok = false;
+    
+    buffer = kmalloc(MAX_IRQ_BUFFER_SIZE, GFP_KERNEL);
+    if (!buffer)
+        return false;
+    
+    snprintf(path, sizeof(path), "/sys/kernel/irq/%u/per_cpu_count", irq);
+    if (read_sysfs_file(path, buffer, MAX_IRQ_BUFFER_SIZE) == 0) {
+        ok = true;
+        cur = buffer;
+        while ((tok = strsep(&cur, ",")) != NULL) {
+            if (kstrtou64(tok, 10, &count) != 0) {
+                ok = false;
+                break;
+            }
+            total += count;
+        }
+    }
+    
+    kfree(buffer);
+    if (ok)
+        *value = total;
+    return ok;
+}
+
+static bool read_irq_counter(struct gpu_monitor *gpu, u64 *value)
+{
+    return read_irq_line(gpu->pdev->irq, value);
+}
+
+// Take a new baseline without deriving a rate. A raw value below the
+// previous one means the hardware counter was reset; the lost value is
+// carried into the offset so the exported total stays continuous.
+static void counter_resync(struct gpu_counter *c, u64 raw, u64 now_ns)
+{
+    if (c->primed && raw < c->raw)
+        c->offset += c->raw;
+    
+    c->raw = raw;
+    c->stamp_ns = now_ns;
+    c->primed = true;
+    c->valid = true;
+}
+
+// Drop the rate baseline; the next reading only re-establishes it
+static void counter_invalidate(struct gpu_counter *c)
+{
+    c->valid = false;
+}
+
+// Advance a counter. Returns true and fills delta/elapsed when a rate can
+// be derived against a valid baseline.
+static bool counter_advance(struct gpu_counter *c, u64 raw, u64 now_ns,
+                            u64 *delta, u64 *elapsed_ns)
+{
+    bool have_rate = c->valid && raw >= c->raw && now_ns > c->stamp_ns;
+    
+    if (have_rate) {
+        *delta = raw - c->raw;
+        *elapsed_ns = now_ns - c->stamp_ns;
+    }
+    
+    counter_resync(c, raw, now_ns);
+    return have_rate;
+}
+
+static u64 counter_total(const struct gpu_counter *c)
+{
+    return c->offset + c->raw;
+}
+
+// Same as sync_gpu_counters for the VFs of a PF
+static void sync_vf_counters(struct gpu_monitor *gpu, u64 now_ns)
+{
+    u64 raw;
+    int k;
+    
+    mutex_lock(&vf_lock);
+    for (k = 0; k < gpu->vf_count; k++) {
+        struct gpu_vf *vf = &gpu->vfs[k];
+        
+        if (vf->irq_available && !pm_runtime_suspended(&vf->pdev->dev) &&
+            read_irq_line(vf->pdev->irq, &raw))
+            counter_resync(&vf->irq_count, raw, now_ns);
+        else
+            counter_invalidate(&vf->irq_count);
+    }
+    mutex_unlock(&vf_lock);
+}
+
+// Checkpoint (before suspend) or resynchronize (after resume) all counter
+// baselines of a GPU at the given time
+static void sync_gpu_counters(struct gpu_monitor *gpu, u64 now_ns)
+{
+    u64 raw;
+    
+    sync_vf_counters(gpu, now_ns);
+    
+    if (pm_runtime_suspended(&gpu->pdev->dev)) {
+        counter_invalidate(&gpu->energy_uj);
+        counter_invalidate(&gpu->rc6_ms);
+        counter_invalidate(&gpu->irq_count);
+        return;
+    }
+    
+    if (gpu->energy_available && read_energy_counter(gpu, &raw))
+        counter_resync(&gpu->energy_uj, raw, now_ns);
+    else
+        counter_invalidate(&gpu->energy_uj);
+    
+    if (gpu->rc6_available && read_rc6_counter(gpu, &raw))
+        counter_resync(&gpu->rc6_ms, raw, now_ns);
+    else
+        counter_invalidate(&gpu->rc6_ms);
+    
+    if (gpu->irq_available && read_irq_counter(gpu, &raw))
+        counter_resync(&gpu->irq_count, raw, now_ns);
+    else
+        counter_invalidate(&gpu->irq_count);
+}
+
+// Read hardware counters and derive per-interval rates
+static void update_gpu_counters(struct gpu_monitor *gpu, u64 now_ns)
+{
+    u64 raw, delta, elapsed;
+    
+    gpu->energy_power_mw = 0;
+    gpu->rc6_pct = 0;
+    gpu->irq_rate = 0;
+    
+    if (gpu->energy_available) {
+        if (read_energy_counter(gpu, &raw)) {
+            if (counter_advance(&gpu->energy_uj, raw, now_ns, &delta, &elapsed))
+                gpu->energy_power_mw = div64_u64(delta * 1000000ULL, elapsed);
+        } else {
+            counter_invalidate(&gpu->energy_uj);
+        }
+    }
+    
+    if (gpu->rc6_available) {
+        if (read_rc6_counter(gpu, &raw)) {
+            if (counter_advance(&gpu->rc6_ms, raw, now_ns, &delta, &elapsed))
+                gpu->rc6_pct = min_t(u64, 100, div64_u64(delta * 100000000ULL, elapsed));
+        } else {
+            counter_invalidate(&gpu->rc6_ms);
+        }
+    }
+    
+    if (gpu->irq_available) {
+        if (read_irq_counter(gpu, &raw)) {
+            if (counter_advance(&gpu->irq_count, raw, now_ns, &delta, &elapsed))
+                gpu->irq_rate = div64_u64(delta * NSEC_PER_SEC, elapsed);
+        } else {
+            counter_invalidate(&gpu->irq_count);
+        }
+    }
+}
+
+static unsigned int put_varint(u8 *p, u64 v)
+{
+    unsigned int n = 0;
+    
+    while (v >= 0x80) {
+        p[n++] = (u8)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (u8)v;
+    return n;
+}
+
+// False if the varint runs past end or is longer than 64 bits
+static bool get_varint(const u8 *data, unsigned int end, unsigned int *pos, u64 *v)
+{
+    unsigned int shift = 0;
+    
+    *v = 0;
+    while (*pos < end && shift < 64) {
+        u8 byte = data[(*pos)++];
+        *v |= (u64)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+        shift += 7;
+    }
+    return false;
+}
+
+static inline u64 zigzag(s64 v)
+{
+    return ((u64)v << 1) ^ (u64)(v >> 63);
+}
+
+static inline s64 unzigzag(u64 v)
+{
+    return (s64)(v >> 1) ^ -(s64)(v & 1);
+}
+
+// Encode s as a delta against base, or as a keyframe when base is NULL
+static unsigned int history_encode(u8 *p, const struct gpu_sample *s,
+                                   const struct gpu_sample *base, u64 base_dt)
+{
+    unsigned int n = 0;
+    u32 mask = 0;
+    int f;
+    
+    if (!base) {
+        for (f = 0; f < HISTORY_FIELDS; f++)
+            n += put_varint(p + n, s->field[f]);
+        return n;
+    }
+    
+    n += put_varint(p, zigzag((s64)(s->timestamp_ns - base->timestamp_ns - base_dt)));
+    for (f = 0; f < HISTORY_FIELDS; f++) {
+        if (s->field[f] != base->field[f])
+            mask |= 1U << f;
+    }
+    n += put_varint(p + n, mask);
+    for (f = 0; f < HISTORY_FIELDS; f++) {
+        if (mask & (1U << f))
+            n += put_varint(p + n, zigzag((s64)s->field[f] - (s64)base->field[f]));
+    }
+    return n;
+}
+
+// Decode the sample at *pos of a chunk into s, which holds the previous
+// sample of the chunk (nothing for the keyframe at 0). *dt tracks the interval.
+static bool history_decode(const struct history_chunk *chunk, unsigned int *pos,
+                           struct gpu_sample *s, u64 *dt)
+{
+    u64 v, mask;
+    int f;
+    
+    if (*pos == 0) {
+        s->timestamp_ns = chunk->key_ns;
+        *dt = 0;
+        for (f = 0; f < HISTORY_FIELDS; f++) {
+            if (!get_varint(chunk->data, chunk->used, pos, &v))
+                return false;
+            s->field[f] = (u32)v;
+        }
+        return true;
+    }
+    
+    if (!get_varint(chunk->data, chunk->used, pos, &v))
+        return false;
+    *dt += unzigzag(v);
+    s->timestamp_ns += *dt;
+    if (!get_varint(chunk->data, chunk->used, pos, &mask))
+        return false;
+    for (f = 0; f < HISTORY_FIELDS; f++) {
+        if (!(mask & (1ULL << f)))
+            continue;
+        if (!get_varint(chunk->data, chunk->used, pos, &v))
+            return false;
+        s->field[f] = (u32)((s64)s->field[f] + unzigzag(v));
+    }
+    return true;
+}
+
+// Append the current metrics to the history, starting a new chunk (and
+// dropping the oldest when all are in use) once the current one is full
+static void history_push(struct gpu_monitor *gpu, u64 now_ns)
+{
+    struct gpu_sample s;
+    struct history_chunk *chunk = NULL;
+    u8 record[HISTORY_MAX_RECORD];
+    unsigned int len = 0;
+    
+    if (!gpu->history)
         return;
+    
+    s.timestamp_ns = now_ns;
+    s.field[HF_FLAGS] = gpu->pending_flags;
+    s.field[HF_TEMPERATURE] = gpu->temperature_c;
+    s.field[HF_CLOCK_MHZ] = gpu->clock_mhz;
+    s.field[HF_POWER_WATTS] = gpu->power_watts;
+    s.field[HF_UTILIZATION] = gpu->utilization_pct;
+    s.field[HF_MEMORY_USED] = gpu->memory_used_mb;
+    s.field[HF_FAN_RPM] = gpu->fan_rpm;
+    s.field[HF_ENERGY_POWER_MW] = gpu->energy_power_mw;
+    s.field[HF_RC6_PCT] = gpu->rc6_pct;
+    s.field[HF_IRQ_RATE] = gpu->irq_rate;
+    
+    mutex_lock(&history_lock);
+    if (gpu->history_chunks) {
+        chunk = &gpu->history[(gpu->history_first + gpu->history_chunks - 1) % HISTORY_CHUNKS];
+        len = history_encode(record, &s, &gpu->history_last, gpu->history_last_dt);
+        if (chunk->used + len > HISTORY_CHUNK_SIZE)
+            chunk = NULL;
+    }
+    
+    if (chunk) {
+        memcpy(chunk->data + chunk->used, record, len);
+        gpu->history_last_dt = now_ns - gpu->history_last.timestamp_ns;
+    } else {
+        if (gpu->history_chunks == HISTORY_CHUNKS) {
+            gpu->history_count -= gpu->history[gpu->history_first].count;
+            gpu->history_first = (gpu->history_first + 1) % HISTORY_CHUNKS;
+            gpu->history_chunks--;
+        }
+        chunk = &gpu->history[(gpu->history_first + gpu->history_chunks) % HISTORY_CHUNKS];
+        gpu->history_chunks++;
+        chunk->key_ns = now_ns;
+        chunk->used = 0;
+        chunk->count = 0;
+        len = history_encode(chunk->data, &s, NULL, 0);
+        gpu->history_last_dt = 0;
+    }
+    chunk->used += len;
+    chunk->count++;
+    gpu->history_count++;
+    gpu->history_last = s;
+    mutex_unlock(&history_lock);
+    
+    gpu->pending_flags = 0;
+}
+
+// Drop the VF references held by a PF's slots
+static void release_vfs(struct gpu_monitor *gpu)
+{
+    int k;
+    
+    for (k = 0; k < gpu->vf_count; k++) {
+        pci_dev_put(gpu->vfs[k].pdev);
+        gpu->vfs[k].pdev = NULL;
+    }
+    gpu->vf_count = 0;
+    gpu->vf_missing = 0;
+}
+
+// Bind the VF slots to the VFs currently on the bus. VFs come and go with
+// writes to sriov_numvfs, so this reruns when their number changes; it
+// walks the PCI devices, so it runs at probe or from the sampler work,
+// never in atomic context. Only VFs whose physfn is this PF are taken, so
+// they never take the place of physical GPUs.
+static void enumerate_vfs(struct gpu_monitor *gpu)
+{
+    struct pci_dev *vf_dev = NULL;
+    int num_vfs = pci_num_vf(gpu->pdev);
+    
+    release_vfs(gpu);
+    
+    // VFs carry their PF's vendor ID
+    while ((vf_dev = pci_get_device(gpu->pdev->vendor, PCI_ANY_ID, vf_dev)) != NULL) {
+        struct gpu_vf *vf;
+        int id;
         
-    // Reset values
-    gpu->memory_used_mb = 0;
-    gpu->temperature_c = 0;
-    gpu->clock_mhz = 0;
-    gpu->power_watts = 0;
-    gpu->utilization_pct = 0;
-    gpu->fan_rpm = 0;
+        if (!vf_dev->is_virtfn || pci_physfn(vf_dev) != gpu->pdev)
+            continue;
+        id = pci_iov_vf_id(vf_dev);
+        if (id < 0 || gpu->vf_count >= gpu->vf_capacity)
+            continue;
+        
+        vf = &gpu->vfs[gpu->vf_count++];
+        memset(vf, 0, sizeof(*vf));
+        vf->pdev = pci_dev_get(vf_dev);
+        vf->vf_id = id;
+        snprintf(vf->pci_address, sizeof(vf->pci_address), "%s", pci_name(vf_dev));
+        
+        if (vf_dev->irq) {
+            char path[MAX_PATH_LEN];
+            
+            snprintf(path, sizeof(path), "/sys/kernel/irq/%u/per_cpu_count", vf_dev->irq);
+            vf->irq_available = path_exists(path);
+        }
+    }
+    
+    gpu->vf_enabled = num_vfs;
+    // Enabled VFs that are not on the bus yet
+    gpu->vf_missing = max(min(num_vfs, gpu->vf_capacity) - gpu->vf_count, 0);
+}
+
+// Sample the VFs of a PF, in the PF's pass
+static void update_vf_data(struct gpu_monitor *gpu, u8 lanes, u64 now_ns)
+{
+    u64 raw, delta, elapsed;
+    int k;
+    
+    mutex_lock(&vf_lock);
+    
+    // Rebind when VFs were enabled or disabled; VFs still being added to
+    // the bus are looked for again with the slow lane
+    if (pci_num_vf(gpu->pdev) != gpu->vf_enabled ||
+        (gpu->vf_missing && (lanes & LANE_SLOW)))
+        enumerate_vfs(gpu);
+    
+    for (k = 0; k < gpu->vf_count; k++) {
+        struct gpu_vf *vf = &gpu->vfs[k];
+        struct device_driver *drv = vf->pdev->dev.driver;
+        
+        // Bound to vfio-pci (or similar) while assigned to a VM
+        snprintf(vf->driver, sizeof(vf->driver), "%s", drv ? drv->name : "none");
+        
+        vf->irq_rate = 0;
+        vf->runtime_suspended = pm_runtime_suspended(&vf->pdev->dev);
+        if (vf->runtime_suspended) {
+            counter_invalidate(&vf->irq_count);
+            continue;
+        }
+        
+        if (vf->irq_available) {
+            if (read_irq_line(vf->pdev->irq, &raw)) {
+                if (counter_advance(&vf->irq_count, raw, now_ns, &delta, &elapsed))
+                    vf->irq_rate = div64_u64(delta * NSEC_PER_SEC, elapsed);
+            } else {
+                counter_invalidate(&vf->irq_count);
+            }
+        }
+    }
+    
+    mutex_unlock(&vf_lock);
+}
+
+static u32 *metric_field(struct gpu_monitor *gpu, enum gpu_metric metric)
+{
+    switch (metric) {
+        case M_MEMORY_TOTAL:
+            return &gpu->memory_total_mb;
+        case M_MEMORY_USED:
+            return &gpu->memory_used_mb;
+        case M_TEMPERATURE:
+            return &gpu->temperature_c;
+        case M_CLOCK:
+            return &gpu->clock_mhz;
+        case M_POWER:
+            return &gpu->power_watts;
+        case M_UTILIZATION:
+            return &gpu->utilization_pct;
+        default:
+            return &gpu->fan_rpm;
+    }
+}
+
+// Zero the values of the due lanes, so an unreadable attribute reads 0
+static void reset_lane_values(struct gpu_monitor *gpu, u8 lanes)
+{
+    int m;
+    
+    for (m = 0; m < GPU_METRICS; m++) {
+        if (lane_due(gpu, lanes, m))
+            *metric_field(gpu, m) = 0;
+    }
+}
+
+static void decimator_add(struct gpu_decimator *d, u32 value, u64 now_ns)
+{
+    if (d->last_ns)
+        d->weighted += (u64)d->last * (now_ns - d->last_ns);
+    else
+        d->start_ns = now_ns;
+    d->last = value;
+    d->last_ns = now_ns;
+    d->sum += value;
+    d->count++;
+    if (value > d->max)
+        d->max = value;
+}
+
+// Reduce the interval ending now and start the next one. The read taken
+// now counts in the mean and max; in the time-weighted average it holds
+// over the next interval.
+static u32 decimator_take(struct gpu_decimator *d, u64 now_ns)
+{
+    u32 value;
+    
+    switch (decimation_mode) {
+        case DECIMATE_MAX:
+            value = d->max;
+            break;
+            
+        case DECIMATE_TWA:
+            if (now_ns > d->start_ns) {
+                value = DIV64_U64_ROUND_CLOSEST(d->weighted, now_ns - d->start_ns);
+                break;
+            }
+            fallthrough;  // First read since a reset: nothing held yet
+            
+        default:
+            value = DIV_ROUND_CLOSEST_ULL(d->sum, d->count);
+            break;
+    }
+    
+    d->published_max = d->max;
+    d->sum = 0;
+    d->weighted = 0;
+    d->count = 0;
+    d->max = 0;
+    d->start_ns = now_ns;
+    return value;
+}
+
+// Values are not held across suspend: the next read starts afresh
+static void reset_decimators(struct gpu_monitor *gpu)
+{
+    int m;
+    
+    for (m = 0; m < GPU_METRICS; m++) {
+        gpu->decimators[m].last_ns = 0;
+        gpu->decimators[m].sum = 0;
+        gpu->decimators[m].weighted = 0;
+        gpu->decimators[m].count = 0;
+        gpu->decimators[m].max = 0;
+    }
+}
+
+// Feed this tick's reads of oversampled metrics to their decimators. The
+// fields keep the published values, replaced by the interval's reduction
+// on a normal tick.
+static void decimate(struct gpu_monitor *gpu, u8 lanes, u64 now_ns, const u32 *published)
+{
+    int m;
+    
+    for (m = 0; m < GPU_METRICS; m++) {
+        u32 *field = metric_field(gpu, m);
+        
+        if (!(gpu->oversampled & BIT(m)))
+            continue;
+        decimator_add(&gpu->decimators[m], *field, now_ns);
+        *field = (lanes & LANE_NORMAL) ? decimator_take(&gpu->decimators[m], now_ns)
+                                       : published[m];
+    }
+}
+
+// Update the due lanes of one GPU. Counters, history and VFs advance with
+// the normal lane, i.e. once per published sample.
+static void update_gpu_data(struct gpu_monitor *gpu, u8 lanes)
+{
+    u32 published[GPU_METRICS];
+    u64 now_ns;
+    int m;
+    
+    if (!gpu || !gpu->pdev)
+        return;
+    
+    // Leave a runtime-suspended GPU alone: reading its attributes would
+    // wake it or return stale values. Its counters are rebaselined by the
+    // first sample after it becomes active again.
+    if (pm_runtime_suspended(&gpu->pdev->dev)) {
+        if (!gpu->runtime_suspended) {
+            gpu->runtime_suspended = true;
+            counter_invalidate(&gpu->energy_uj);
+            counter_invalidate(&gpu->rc6_ms);
+            counter_invalidate(&gpu->irq_count);
+        }
+        return;
+    }
+    
+    if (gpu->runtime_suspended) {
+        gpu->runtime_suspended = false;
+        gpu->pending_flags |= SAMPLE_FLAG_RUNTIME_PM;
+        gpu->gap_count++;
+        // Static and slow values may have changed while suspended; normal
+        // ones are refreshed by the next published sample
+        lanes |= LANE_STATIC | LANE_SLOW;
+        reset_decimators(gpu);
+    }
+    
+    now_ns = ktime_get_boottime_ns();
+    
+    // Oversampled metrics are read into their fields every tick
+    for (m = 0; m < GPU_METRICS; m++)
+        published[m] = *metric_field(gpu, m);
+    
+    reset_lane_values(gpu, lanes);
     
     // Read data based on vendor
     switch (gpu->vendor_id) {
         case PCI_VENDOR_ID_NVIDIA:
-            read_nvidia_data(gpu);
+            read_nvidia_data(gpu, lanes);
             break;
             
         case PCI_VENDOR_ID_AMD:
-            read_amd_data(gpu);
+            read_amd_data(gpu, lanes);
             break;
             
         case PCI_VENDOR_ID_INTEL:
-            read_intel_data(gpu);
+            read_intel_data(gpu, lanes);
             break;
             
         default:
@@ -476,33 +1342,81 @@ static void update_gpu_data(struct gpu_monitor *gpu)
             break;
     }
     
+    decimate(gpu, lanes, now_ns, published);
+    
+    if (!(lanes & LANE_NORMAL))
+        return;
+    
+    update_gpu_counters(gpu, now_ns);
+    history_push(gpu, now_ns);
+    
+    if (gpu->vfs)
+        update_vf_data(gpu, lanes, now_ns);
+    
     gpu->last_update = jiffies;
 }
 
-// Timer callback
-static void update_timer_callback(struct timer_list *t)
+// Lanes due at a tick; tick 0 (load, resume) reads everything
+static u8 lanes_at_tick(unsigned int tick)
 {
+    u8 lanes = LANE_FAST;
+    
+    if (tick == 0)
+        return LANES_ALL;
+    if (tick % NORMAL_TICKS == 0)
+        lanes |= LANE_NORMAL;
+    if (tick % SLOW_TICKS == 0)
+        lanes |= LANE_SLOW;
+    return lanes;
+}
+
+// Sampler work: one pass over the GPUs per tick, reading the due lanes
+static void update_work_fn(struct work_struct *work)
+{
+    u8 lanes;
     int i;
     
+    if (sampling_paused)
+        return;
+    
+    lanes = lanes_at_tick(sample_tick);
     for (i = 0; i < gpu_count; i++) {
         if (gpus[i]) {
-            update_gpu_data(gpus[i]);
+            update_gpu_data(gpus[i], lanes);
         }
     }
     
-    // Schedule next update (every 3 seconds)
-    mod_timer(&update_timer, jiffies + 3 * HZ);
+    // Pollers wake per published sample, not per fast tick
+    if (lanes & LANE_NORMAL) {
+        atomic64_inc(&sample_seq);
+        wake_up_interruptible(&sample_wait);
+    }
+    
+    sample_tick++;
+    schedule_delayed_work(&update_work, msecs_to_jiffies(SAMPLE_TICK_MS));
 }
 
 // Proc file show function
 static int gpu_proc_show(struct seq_file *m, void *v)
 {
-    int i;
+    s64 *seen_seq = m->private;
+    int i, k;
+    
+    // Remember which sample this reader got, for gpu_proc_poll
+    WRITE_ONCE(*seen_seq, atomic64_read(&sample_seq));
     
     seq_printf(m, "GPU_COUNT:%d\n", gpu_count);
     seq_printf(m, "LAST_UPDATE:%lu\n", jiffies);
+    seq_printf(m, "SAMPLE_SEQ:%lld\n", *seen_seq);
     seq_printf(m, "DATA_SOURCE:REAL_HARDWARE_SYSFS\n");
     seq_printf(m, "MODULE_VERSION:2.0\n");
+    seq_printf(m, "PM_STATE:%s\n", sampling_paused ? "SUSPENDED" : "ACTIVE");
+    seq_printf(m, "SUSPEND_COUNT:%u\n", suspend_count);
+    seq_printf(m, "SUSPENDED_TOTAL_MS:%llu\n", div_u64(suspended_total_ns, NSEC_PER_MSEC));
+    seq_printf(m, "SAMPLE_INTERVAL_MS:%d\n", SAMPLE_TICK_MS * NORMAL_TICKS);
+    seq_printf(m, "FAST_INTERVAL_MS:%d\n", SAMPLE_TICK_MS);
+    seq_printf(m, "SLOW_INTERVAL_MS:%d\n", SAMPLE_TICK_MS * SLOW_TICKS);
+    seq_printf(m, "DECIMATION:%s\n", decimation_names[decimation_mode]);
     seq_printf(m, "\n");
     
     for (i = 0; i < gpu_count; i++) {
@@ -530,6 +1444,22 @@ static int gpu_proc_show(struct seq_file *m, void *v)
         seq_printf(m, "GPU_%d_UTILIZATION:%u\n", i, gpu->utilization_pct);
         seq_printf(m, "GPU_%d_FAN_RPM:%u\n", i, gpu->fan_rpm);
         
+        // Peaks of oversampled metrics within the last sample interval
+        for (k = 0; k < GPU_METRICS; k++) {
+            if (gpu->oversampled & BIT(k))
+                seq_printf(m, "GPU_%d_%s_MAX:%u\n", i, metric_names[k],
+                          gpu->decimators[k].published_max);
+        }
+        
+        // Counters and derived rates
+        seq_printf(m, "GPU_%d_ENERGY_UJ:%llu\n", i, counter_total(&gpu->energy_uj));
+        seq_printf(m, "GPU_%d_ENERGY_POWER_MW:%u\n", i, gpu->energy_power_mw);
+        seq_printf(m, "GPU_%d_RC6_PCT:%u\n", i, gpu->rc6_pct);
+        seq_printf(m, "GPU_%d_IRQ_COUNT:%llu\n", i, counter_total(&gpu->irq_count));
+        seq_printf(m, "GPU_%d_IRQ_RATE:%u\n", i, gpu->irq_rate);
+        seq_printf(m, "GPU_%d_RUNTIME_SUSPENDED:%d\n", i, gpu->runtime_suspended);
+        seq_printf(m, "GPU_%d_GAP_COUNT:%u\n", i, gpu->gap_count);
+        
         // Capability flags
         seq_printf(m, "GPU_%d_CAPS_TEMP:%d\n", i, gpu->temp_available);
         seq_printf(m, "GPU_%d_CAPS_POWER:%d\n", i, gpu->power_available);
@@ -537,6 +1467,31 @@ static int gpu_proc_show(struct seq_file *m, void *v)
         seq_printf(m, "GPU_%d_CAPS_UTIL:%d\n", i, gpu->util_available);
         seq_printf(m, "GPU_%d_CAPS_CLOCK:%d\n", i, gpu->clock_available);
         seq_printf(m, "GPU_%d_CAPS_FAN:%d\n", i, gpu->fan_available);
+        seq_printf(m, "GPU_%d_CAPS_ENERGY:%d\n", i, gpu->energy_available);
+        seq_printf(m, "GPU_%d_CAPS_RC6:%d\n", i, gpu->rc6_available);
+        seq_printf(m, "GPU_%d_CAPS_IRQ:%d\n", i, gpu->irq_available);
+        
+        // SR-IOV virtual functions, as children of this GPU
+        if (gpu->vfs) {
+            mutex_lock(&vf_lock);
+            seq_printf(m, "GPU_%d_SRIOV_TOTAL_VFS:%d\n", i, pci_sriov_get_totalvfs(gpu->pdev));
+            seq_printf(m, "GPU_%d_SRIOV_NUM_VFS:%d\n", i, gpu->vf_enabled);
+            for (k = 0; k < gpu->vf_count; k++) {
+                const struct gpu_vf *vf = &gpu->vfs[k];
+                
+                seq_printf(m, "GPU_%d_VF_%d_PCI_PATH:/sys/bus/pci/devices/%s\n",
+                          i, vf->vf_id, vf->pci_address);
+                seq_printf(m, "GPU_%d_VF_%d_DRIVER:%s\n", i, vf->vf_id, vf->driver);
+                seq_printf(m, "GPU_%d_VF_%d_RUNTIME_SUSPENDED:%d\n", i, vf->vf_id,
+                          vf->runtime_suspended);
+                if (vf->irq_available) {
+                    seq_printf(m, "GPU_%d_VF_%d_IRQ_COUNT:%llu\n", i, vf->vf_id,
+                              counter_total(&vf->irq_count));
+                    seq_printf(m, "GPU_%d_VF_%d_IRQ_RATE:%u\n", i, vf->vf_id, vf->irq_rate);
+                }
+            }
+            mutex_unlock(&vf_lock);
+        }
         
         seq_printf(m, "GPU_%d_LAST_UPDATE:%lu\n", i, gpu->last_update);
         seq_printf(m, "\n");
@@ -547,16 +1502,170 @@ static int gpu_proc_show(struct seq_file *m, void *v)
 
 static int gpu_proc_open(struct inode *inode, struct file *file)
 {
-    return single_open(file, gpu_proc_show, NULL);
+    s64 *seen_seq;
+    int ret;
+    
+    // Per-open state: the SAMPLE_SEQ this reader saw last (-1: none yet)
+    seen_seq = kmalloc(sizeof(*seen_seq), GFP_KERNEL);
+    if (!seen_seq)
+        return -ENOMEM;
+    *seen_seq = -1;
+    
+    ret = single_open(file, gpu_proc_show, seen_seq);
+    if (ret)
+        kfree(seen_seq);
+    return ret;
+}
+
+static int gpu_proc_release(struct inode *inode, struct file *file)
+{
+    struct seq_file *m = file->private_data;
+    
+    kfree(m->private);
+    return single_release(inode, file);
+}
+
+// Readable once a sample newer than the one last read exists. Readers
+// keep the file open, poll() it, then lseek(0) and read again.
+static __poll_t gpu_proc_poll(struct file *file, poll_table *wait)
+{
+    struct seq_file *m = file->private_data;
+    s64 *seen_seq = m->private;
+    
+    poll_wait(file, &sample_wait, wait);
+    if (atomic64_read(&sample_seq) != READ_ONCE(*seen_seq))
+        return EPOLLIN | EPOLLRDNORM;
+    return 0;
 }
 
 static const struct proc_ops gpu_proc_fops = {
     .proc_open = gpu_proc_open,
     .proc_read = seq_read,
     .proc_lseek = seq_lseek,
+    .proc_release = gpu_proc_release,
+    .proc_poll = gpu_proc_poll,
+};
+
+// History proc file show function. A GPU_<n>_GAP line precedes every
+// sample taken after a suspend, so consumers never derive rates across it.
+static int gpu_history_show(struct seq_file *m, void *v)
+{
+    int i;
+    unsigned int c, k;
+    
+    seq_printf(m, "HISTORY_BYTES:%zu\n", HISTORY_CHUNKS * sizeof(struct history_chunk));
+    seq_printf(m, "HISTORY_FIELDS:TIMESTAMP_NS,FLAGS,TEMPERATURE,CLOCK_MHZ,POWER_WATTS,"
+                  "UTILIZATION,MEMORY_USED,FAN_RPM,ENERGY_POWER_MW,RC6_PCT,IRQ_RATE\n");
+    seq_printf(m, "\n");
+    
+    for (i = 0; i < gpu_count; i++) {
+        struct gpu_monitor *gpu = gpus[i];
+        unsigned int bytes = 0;
+        
+        if (!gpu || !gpu->history) continue;
+        
+        mutex_lock(&history_lock);
+        for (c = 0; c < gpu->history_chunks; c++)
+            bytes += gpu->history[(gpu->history_first + c) % HISTORY_CHUNKS].used;
+        seq_printf(m, "GPU_%d_HISTORY_COUNT:%u\n", i, gpu->history_count);
+        seq_printf(m, "GPU_%d_HISTORY_ENCODED_BYTES:%u\n", i, bytes);
+        for (c = 0; c < gpu->history_chunks; c++) {
+            const struct history_chunk *chunk =
+                &gpu->history[(gpu->history_first + c) % HISTORY_CHUNKS];
+            struct gpu_sample s;
+            unsigned int pos = 0;
+            u64 dt = 0;
+            
+            for (k = 0; k < chunk->count; k++) {
+                if (!history_decode(chunk, &pos, &s, &dt))
+                    break;  // Never written that way; skip the rest of the chunk
+                
+                if (s.field[HF_FLAGS] & (SAMPLE_FLAG_GAP | SAMPLE_FLAG_RUNTIME_PM))
+                    seq_printf(m, "GPU_%d_GAP:%llu\n", i, s.timestamp_ns);
+                
+                seq_printf(m, "GPU_%d_SAMPLE:%llu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", i,
+                          s.timestamp_ns, s.field[HF_FLAGS], s.field[HF_TEMPERATURE],
+                          s.field[HF_CLOCK_MHZ], s.field[HF_POWER_WATTS],
+                          s.field[HF_UTILIZATION], s.field[HF_MEMORY_USED],
+                          s.field[HF_FAN_RPM], s.field[HF_ENERGY_POWER_MW],
+                          s.field[HF_RC6_PCT], s.field[HF_IRQ_RATE]);
+            }
+        }
+        mutex_unlock(&history_lock);
+        seq_printf(m, "\n");
+    }
+    
+    return 0;
+}
+
+static int gpu_history_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, gpu_history_show, NULL);
+}
+
+static const struct proc_ops gpu_history_fops = {
+    .proc_open = gpu_history_open,
+    .proc_read = seq_read,
+    .proc_lseek = seq_lseek,
     .proc_release = single_release,
 };
 
+// System suspend/hibernate notifier. Sampling is paused for the duration,
+// counter baselines are checkpointed before and resynchronized after, and
+// the next history sample of every GPU is flagged as following a gap.
+static int gpu_pm_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+    u64 now_ns;
+    int i;
+    
+    switch (action) {
+        case PM_SUSPEND_PREPARE:
+        case PM_HIBERNATION_PREPARE:
+            sampling_paused = true;
+            cancel_delayed_work_sync(&update_work);
+            
+            now_ns = ktime_get_boottime_ns();
+            for (i = 0; i < gpu_count; i++) {
+                if (gpus[i])
+                    sync_gpu_counters(gpus[i], now_ns);
+            }
+            suspend_start_ns = now_ns;
+            pr_info("GPU Monitor: Sampling paused for suspend\n");
+            break;
+            
+        case PM_POST_SUSPEND:
+        case PM_POST_HIBERNATION:
+        case PM_POST_RESTORE:
+            if (!sampling_paused)
+                break;
+            
+            now_ns = ktime_get_boottime_ns();
+            for (i = 0; i < gpu_count; i++) {
+                if (gpus[i]) {
+                    sync_gpu_counters(gpus[i], now_ns);
+                    reset_decimators(gpus[i]);
+                    gpus[i]->pending_flags |= SAMPLE_FLAG_GAP;
+                    gpus[i]->gap_count++;
+                }
+            }
+            suspend_count++;
+            suspended_total_ns += now_ns - suspend_start_ns;
+            
+            sampling_paused = false;
+            sample_tick = 0;  // Full pass first
+            schedule_delayed_work(&update_work, msecs_to_jiffies(SAMPLE_TICK_MS));
+            pr_info("GPU Monitor: Sampling resumed after %llu ms\n",
+                   div_u64(now_ns - suspend_start_ns, NSEC_PER_MSEC));
+            break;
+    }
+    
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block gpu_pm_nb = {
+    .notifier_call = gpu_pm_notify,
+};
+
 // Detect and initialize GPU devices
 static int detect_gpus(void)
 {
@@ -571,6 +1680,10 @@ static int detect_gpus(void)
         // Check if it's a graphics device (class 0x0300 or 0x0302)
         if (((pdev->class >> 8) != 0x0300) && ((pdev->class >> 8) != 0x0302))
             continue;
+        
+        // VFs are reported under their PF, see enumerate_vfs()
+        if (pdev->is_virtfn)
+            continue;
             
         // Allocate GPU monitor structure
         gpu = kzalloc(sizeof(struct gpu_monitor), GFP_KERNEL);
@@ -615,6 +1728,23 @@ static int detect_gpus(void)
         
         // Initialize paths and capabilities
         init_gpu_paths(gpu);
+        init_gpu_lanes(gpu);
+        
+        // History is optional; monitoring continues without it
+        gpu->history = kvcalloc(HISTORY_CHUNKS, sizeof(struct history_chunk), GFP_KERNEL);
+        if (!gpu->history)
+            pr_warn("GPU Monitor: No history buffer for GPU %d\n", count);
+        
+        // SR-IOV capable: slots for every VF the PF can enable
+        gpu->vf_capacity = min(pci_sriov_get_totalvfs(pdev), MAX_VFS_PER_GPU);
+        if (gpu->vf_capacity > 0) {
+            gpu->vfs = kcalloc(gpu->vf_capacity, sizeof(*gpu->vfs), GFP_KERNEL);
+            if (gpu->vfs) {
+                enumerate_vfs(gpu);
+                pr_info("GPU Monitor: GPU %d is an SR-IOV PF, %d of %d VF(s) enabled\n",
+                       count, gpu->vf_enabled, pci_sriov_get_totalvfs(pdev));
+            }
+        }
         
         // Store GPU
         gpus[count] = gpu;
@@ -632,6 +1762,28 @@ static int detect_gpus(void)
     return gpu_count > 0 ? 0 : -ENODEV;
 }
 
+// Release what detect_gpus() took: VF and PF references, history, structures
+static void free_gpus(void)
+{
+    int i;
+    
+    for (i = 0; i < gpu_count; i++) {
+        if (gpus[i]) {
+            if (gpus[i]->vfs) {
+                release_vfs(gpus[i]);
+                kfree(gpus[i]->vfs);
+            }
+            if (gpus[i]->pdev) {
+                pci_dev_put(gpus[i]->pdev);
+            }
+            kvfree(gpus[i]->history);
+            kfree(gpus[i]);
+            gpus[i] = NULL;
+        }
+    }
+    gpu_count = 0;
+}
+
 // Module initialization
 static int __init gpu_monitor_init(void)
 {
@@ -641,6 +1793,14 @@ static int __init gpu_monitor_init(void)
     
     // Initialize GPU array
     memset(gpus, 0, sizeof(gpus));
+    INIT_DELAYED_WORK(&update_work, update_work_fn);
+    
+    ret = match_string(decimation_names, ARRAY_SIZE(decimation_names), decimation);
+    if (ret < 0)
+        pr_warn("GPU Monitor: Unknown decimation '%s', using %s\n",
+                decimation, decimation_names[decimation_mode]);
+    else
+        decimation_mode = ret;
     
     // Detect GPUs
     ret = detect_gpus();
@@ -653,44 +1813,54 @@ static int __init gpu_monitor_init(void)
     proc_entry = proc_create(PROC_NAME, 0644, NULL, &gpu_proc_fops);
     if (!proc_entry) {
         pr_err("GPU Monitor: Failed to create proc entry\n");
-        return -ENOMEM;
+        ret = -ENOMEM;
+        goto err_free_gpus;
+    }
+    
+    history_proc_entry = proc_create(HISTORY_PROC_NAME, 0444, NULL, &gpu_history_fops);
+    if (!history_proc_entry) {
+        pr_warn("GPU Monitor: Failed to create history proc entry\n");
     }
     
-    // Initialize timer
-    timer_setup(&update_timer, update_timer_callback, 0);
+    // Initial data collection, which also schedules the next tick
+    update_work_fn(&update_work.work);
     
-    // Initial data collection
-    update_timer_callback(&update_timer);
+    ret = register_pm_notifier(&gpu_pm_nb);
+    if (ret) {
+        pr_warn("GPU Monitor: Failed to register PM notifier (%d)\n", ret);
+    }
     
     pr_info("GPU Monitor: Module loaded successfully\n");
     pr_info("GPU Monitor: Data available at /proc/%s\n", PROC_NAME);
     
     return 0;
+    
+err_free_gpus:
+    sampling_paused = true;
+    cancel_delayed_work_sync(&update_work);
+    free_gpus();
+    return ret;
 }
 
 // Module cleanup
 static void __exit gpu_monitor_exit(void)
 {
-    int i;
+    unregister_pm_notifier(&gpu_pm_nb);
     
-    // Stop timer
-    del_timer_sync(&update_timer);
+    // Stop sampling
+    sampling_paused = true;
+    cancel_delayed_work_sync(&update_work);
     
-    // Remove proc entry
+    // Remove proc entries
+    if (history_proc_entry) {
+        proc_remove(history_proc_entry);
+    }
     if (proc_entry) {
         proc_remove(proc_entry);
     }
+    wake_up_interruptible_all(&sample_wait);
     
-    // Clean up GPU structures
-    for (i = 0; i < gpu_count; i++) {
-        if (gpus[i]) {
-            if (gpus[i]->pdev) {
-                pci_dev_put(gpus[i]->pdev);
-            }
-            kfree(gpus[i]);
-            gpus[i] = NULL;
-        }
-    }
+    free_gpus();
     
     pr_info("GPU Monitor: Module unloaded\n");
 }
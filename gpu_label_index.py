@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""
+GPU Label Index
+Inverted index from labels to series ids for the fleet aggregator. Every
+GPU a node reports becomes a series with its node's labels (node, rack,
+...) and its own: name, vendor_id, device_id, driver, pci_path and gpu,
+i.e. the NAME, VENDOR_ID, DEVICE_ID, DRIVER and PCI_PATH keys of
+/proc/gpu_monitor. Each label value has a posting list of series ids.
+
+Posting lists are hashed sets, so intersecting two costs a probe per id
+of the smaller one. A selection intersects its lists smallest first, so
+the candidates only shrink and the cost follows the most selective label
+rather than the fleet size; only the final ids are sorted. Alternatives
+(driver=amdgpu|i915) are intersected one by one, not unioned up front.
+"""
+
+
+class LabelIndex:
+    """label -> value -> set of series ids"""
+
+    def __init__(self):
+        self.postings = {}
+        self.labels = {}        # series id -> labels of live series
+        self.next_id = 0
+
+    def __len__(self):
+        return len(self.labels)
+
+    def add(self, labels):
+        """Index a series; returns its id"""
+        series_id = self.next_id
+        self.next_id += 1
+        labels = {str(label): str(value) for label, value in labels.items()}
+        self.labels[series_id] = labels
+        for label, value in labels.items():
+            self.postings.setdefault(label, {}).setdefault(value, set()).add(series_id)
+        return series_id
+
+    def remove(self, series_id):
+        """Drop a series (node re-registered with other GPUs or labels)"""
+        labels = self.labels.pop(series_id, None)
+        if labels is None:
+            return
+        for label, value in labels.items():
+            values = self.postings[label]
+            posting = values[value]
+            posting.discard(series_id)
+            if not posting:
+                del values[value]
+                if not values:
+                    del self.postings[label]
+
+    def postings_of(self, label, value):
+        """Posting lists of one label value, or of each alternative of a list"""
+        values = self.postings.get(label, {})
+        if isinstance(value, (list, tuple)):
+            return [values[str(one)] for one in value if str(one) in values]
+        posting = values.get(str(value))
+        return [posting] if posting is not None else []
+
+    def select(self, selector):
+        """
+        Ascending ids of series matching every label of the selector; a
+        list of values matches any of them
+        """
+        if not selector:
+            return sorted(self.labels)
+        terms = sorted((self.postings_of(label, value) for label, value in selector.items()),
+                       key=lambda term: sum(map(len, term)))
+        first = terms[0]
+        if not first:
+            return []
+        result = first[0] if len(first) == 1 else set().union(*first)
+        for term in terms[1:]:
+            if not result:
+                break
+            if len(term) == 1:
+                result = result & term[0]
+            else:
+                # Candidates against each alternative, never the (larger) union
+                result = set().union(*(result & posting for posting in term))
+        return sorted(result)
+
+    def values(self, label):
+        """Label value -> series count, e.g. to list the racks or drivers in the fleet"""
+        return {value: len(posting) for value, posting in self.postings.get(label, {}).items()}
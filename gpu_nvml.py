@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""
+GPU NVML Backend
+The proprietary NVIDIA driver exposes almost nothing through hwmon, so the
+collector loads NVML (libnvidia-ml.so.1) with ctypes when it is present
+and samples NVIDIA GPUs through it: utilization, memory, clocks, power,
+temperature and throttle reasons in one pass per GPU, written into the
+collector's flat value slots. Devices are matched to the collector's GPUs
+by PCI address. gpu_fake_nvml.c builds a stand-in library for machines
+without an NVIDIA GPU.
+"""
+import ctypes
+
+NVML_LIBRARY = 'libnvidia-ml.so.1'
+
+PCI_VENDOR_ID_NVIDIA = 0x10de
+
+NVML_SUCCESS = 0
+NVML_TEMPERATURE_GPU = 0
+NVML_CLOCK_GRAPHICS = 0
+NVML_CLOCK_MEM = 2
+
+MIB = 1024 * 1024
+
+# Metrics only NVML provides; appended to the collector's native metrics
+NVML_METRICS = ['MEMORY_CLOCK_MHZ', 'THROTTLE_REASONS']
+
+# Everything one pass writes, in NVMLBackend.sample() order
+SAMPLED_METRICS = ['UTILIZATION', 'MEMORY_USED', 'MEMORY_TOTAL', 'TEMPERATURE',
+                   'POWER_WATTS', 'CLOCK_MHZ'] + NVML_METRICS
+
+
+class _Utilization(ctypes.Structure):
+    _fields_ = [('gpu', ctypes.c_uint), ('memory', ctypes.c_uint)]
+
+
+class _Memory(ctypes.Structure):
+    _fields_ = [('total', ctypes.c_ulonglong), ('free', ctypes.c_ulonglong),
+                ('used', ctypes.c_ulonglong)]
+
+
+class NVMLError(RuntimeError):
+    pass
+
+
+class _Device:
+    """One NVML handle, its output buffers and its collector slots"""
+
+    def __init__(self, gpu, handle, slots):
+        self.gpu = gpu
+        self.handle = handle
+        self.utilization = _Utilization()
+        self.memory = _Memory()
+        self.temperature = ctypes.c_uint()
+        self.power_mw = ctypes.c_uint()
+        self.clock = ctypes.c_uint()
+        self.memory_clock = ctypes.c_uint()
+        self.reasons = ctypes.c_ulonglong()
+        self.slots = slots  # Flat value index of each SAMPLED_METRICS entry
+
+
+class NVMLBackend:
+    """Samples the collector's NVIDIA GPUs through NVML"""
+
+    def __init__(self, library=None):
+        self.library = library or NVML_LIBRARY
+        try:
+            self.lib = ctypes.CDLL(self.library)
+        except OSError as e:
+            raise NVMLError(f"cannot load {self.library}: {e}")
+
+        lib = self.lib
+        try:
+            lib.nvmlErrorString.restype = ctypes.c_char_p
+            lib.nvmlErrorString.argtypes = [ctypes.c_int]
+            self._utilization = lib.nvmlDeviceGetUtilizationRates
+            self._memory = lib.nvmlDeviceGetMemoryInfo
+            self._temperature = lib.nvmlDeviceGetTemperature
+            self._power = lib.nvmlDeviceGetPowerUsage
+            self._clock = lib.nvmlDeviceGetClockInfo
+            self._reasons = lib.nvmlDeviceGetCurrentClocksThrottleReasons
+            self._handle_by_bus_id = lib.nvmlDeviceGetHandleByPciBusId_v2
+        except AttributeError as e:
+            raise NVMLError(f"{self.library}: {e}")
+        self._handle_by_bus_id.argtypes = [ctypes.c_char_p, ctypes.POINTER(ctypes.c_void_p)]
+        for fn in (self._utilization, self._memory, self._temperature, self._power,
+                   self._clock, self._reasons):
+            fn.restype = ctypes.c_int
+
+        self.check(lib.nvmlInit_v2(), 'nvmlInit')
+        self.devices = []
+        self.closed = False
+
+    def check(self, ret, what):
+        if ret != NVML_SUCCESS:
+            raise NVMLError(f"{what}: {self.lib.nvmlErrorString(ret).decode()}")
+
+    def attach(self, gpus, metric_index, metric_count):
+        """Find each GPU's NVML handle; GPUs NVML does not know are skipped"""
+        self.devices = []
+        for gpu in gpus:
+            if gpu.vendor_id != PCI_VENDOR_ID_NVIDIA:
+                continue
+            handle = ctypes.c_void_p()
+            ret = self._handle_by_bus_id(gpu.pci_address.encode(), ctypes.byref(handle))
+            if ret != NVML_SUCCESS:
+                continue
+            base = gpu.index * metric_count
+            slots = tuple(base + metric_index[name] for name in SAMPLED_METRICS)
+            self.devices.append(_Device(gpu, handle, slots))
+        return len(self.devices)
+
+    def sample(self, values):
+        """One pass per GPU; readings NVML refuses keep their sysfs value or NaN"""
+        byref = ctypes.byref
+        for device in self.devices:
+            handle = device.handle
+            util, used, total, temp, power, clock, memory_clock, reasons = device.slots
+            if self._utilization(handle, byref(device.utilization)) == NVML_SUCCESS:
+                values[util] = device.utilization.gpu
+            if self._memory(handle, byref(device.memory)) == NVML_SUCCESS:
+                values[used] = device.memory.used / MIB
+                values[total] = device.memory.total / MIB
+            if self._temperature(handle, NVML_TEMPERATURE_GPU,
+                                 byref(device.temperature)) == NVML_SUCCESS:
+                values[temp] = device.temperature.value
+            if self._power(handle, byref(device.power_mw)) == NVML_SUCCESS:
+                values[power] = device.power_mw.value / 1000.0
+            if self._clock(handle, NVML_CLOCK_GRAPHICS, byref(device.clock)) == NVML_SUCCESS:
+                values[clock] = device.clock.value
+            if self._clock(handle, NVML_CLOCK_MEM, byref(device.memory_clock)) == NVML_SUCCESS:
+                values[memory_clock] = device.memory_clock.value
+            if self._reasons(handle, byref(device.reasons)) == NVML_SUCCESS:
+                values[reasons] = device.reasons.value
+
+    def close(self):
+        if not self.closed:
+            self.lib.nvmlShutdown()
+            self.closed = True
+        self.devices = []
+
+
+def load_nvml(library=None, required=False):
+    """
+    Initialized NVML backend, or None. Without required, a missing
+    library or driver just means no NVML.
+    """
+    try:
+        backend = NVMLBackend(library)
+    except NVMLError:
+        if required:
+            raise
+        return None
+    return backend
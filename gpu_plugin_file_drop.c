@@ -0,0 +1,150 @@
+/*
+ * File-drop collector plugin
+ *
+ * Publishes readings that another agent (e.g. a BMC poller) drops into
+ * GPU_FILE_DROP_DIR (default /run/gpu_file_drop), one file per GPU named
+ * after its PCI address and holding KEY=VALUE lines:
+ *
+ *   /run/gpu_file_drop/0000:03:00.0
+ *     INLET_TEMP=31.5
+ *     BOARD_POWER=245
+ *
+ * Build: make plugins   (gcc -shared -fPIC -O2 -o gpu_plugin_file_drop.so ...)
+ * Use:   python3 gpu_collector.py --plugin ./gpu_plugin_file_drop.so
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gpu_collector_plugin.h"
+
+#define DEFAULT_DROP_DIR "/run/gpu_file_drop"
+#define DROP_BUFFER_SIZE 1024
+
+static const char *const file_drop_metrics[] = {
+    "INLET_TEMP",
+    "OUTLET_TEMP",
+    "BOARD_POWER",
+    "BMC_FAN_RPM",
+};
+#define FILE_DROP_METRIC_COUNT (sizeof(file_drop_metrics) / sizeof(file_drop_metrics[0]))
+
+struct file_drop {
+    uint32_t device_count;
+    char (*paths)[PATH_MAX];
+};
+
+static int file_drop_discover(const struct gpu_plugin_device *devices, uint32_t device_count,
+                              void **ctx)
+{
+    const char *dir = getenv("GPU_FILE_DROP_DIR");
+    struct file_drop *drop;
+    uint32_t i;
+
+    if (!dir || !*dir)
+        dir = DEFAULT_DROP_DIR;
+
+    drop = calloc(1, sizeof(*drop));
+    if (!drop)
+        return -ENOMEM;
+    drop->paths = calloc(device_count ? device_count : 1, sizeof(*drop->paths));
+    if (!drop->paths) {
+        free(drop);
+        return -ENOMEM;
+    }
+    drop->device_count = device_count;
+
+    // Files are looked up per sample: the agent may create them later
+    for (i = 0; i < device_count; i++)
+        snprintf(drop->paths[i], PATH_MAX, "%s/%s", dir, devices[i].pci_address);
+
+    *ctx = drop;
+    return 0;
+}
+
+static int metric_index(const char *key, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < FILE_DROP_METRIC_COUNT; i++) {
+        if (strlen(file_drop_metrics[i]) == len && !strncmp(file_drop_metrics[i], key, len))
+            return (int)i;
+    }
+    return -1;
+}
+
+static void parse_drop(const char *buffer, double *values)
+{
+    const char *line = buffer;
+
+    while (*line) {
+        const char *end = strchr(line, '\n');
+        const char *eq = strchr(line, '=');
+        size_t len = end ? (size_t)(end - line) : strlen(line);
+
+        if (eq && eq < line + len) {
+            int index = metric_index(line, (size_t)(eq - line));
+            if (index >= 0) {
+                char *stop;
+                double value = strtod(eq + 1, &stop);
+                if (stop != eq + 1)
+                    values[index] = value;
+            }
+        }
+        if (!end)
+            break;
+        line = end + 1;
+    }
+}
+
+static int file_drop_sample(void *ctx, uint64_t timestamp_ns, double *values)
+{
+    struct file_drop *drop = ctx;
+    char buffer[DROP_BUFFER_SIZE];
+    uint32_t i;
+
+    (void)timestamp_ns;
+    for (i = 0; i < drop->device_count; i++) {
+        int fd = open(drop->paths[i], O_RDONLY | O_CLOEXEC);
+        ssize_t len;
+
+        if (fd < 0)
+            continue;  // No readings for this GPU (yet)
+        len = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if (len <= 0)
+            continue;
+        buffer[len] = '\0';
+        parse_drop(buffer, values + (size_t)i * FILE_DROP_METRIC_COUNT);
+    }
+    return 0;
+}
+
+static void file_drop_close(void *ctx)
+{
+    struct file_drop *drop = ctx;
+
+    if (!drop)
+        return;
+    free(drop->paths);
+    free(drop);
+}
+
+static const struct gpu_plugin file_drop_plugin = {
+    .abi_version = GPU_PLUGIN_ABI_VERSION,
+    .metric_count = FILE_DROP_METRIC_COUNT,
+    .name = "file_drop",
+    .metrics = file_drop_metrics,
+    .discover = file_drop_discover,
+    .sample = file_drop_sample,
+    .close = file_drop_close,
+};
+
+const struct gpu_plugin *gpu_plugin_describe(void)
+{
+    return &file_drop_plugin;
+}
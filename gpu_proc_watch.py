@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+GPU Proc Watch
+Follows /proc/gpu_monitor sample by sample, so viewers redraw when the
+module has taken a new sample instead of on a fixed timer. The module
+bumps SAMPLE_SEQ after every sampling pass and wakes poll() waiters on
+the open file; ProcWatcher keeps the file open, waits on it, and reports
+whether a read holds a sample it has not returned before. Modules without
+SAMPLE_SEQ are handled by comparing the per-GPU LAST_UPDATE stamps after
+sleeping out the timeout, as are files whose poll() is always ready (a
+copy of the proc file on a regular filesystem, for instance).
+"""
+import select
+import time
+
+
+def parse_proc(text):
+    """KEY:VALUE lines to a flat dict"""
+    data = {}
+    for line in text.splitlines():
+        if ':' in line:
+            key, value = line.split(':', 1)
+            data[key.strip()] = value.strip()
+    return data
+
+
+class ProcWatcher:
+    """wait() for the next sample, read() it; read() is None when nothing is new"""
+
+    def __init__(self, proc_file="/proc/gpu_monitor"):
+        self.proc_file = proc_file
+        self.file = None
+        self.poller = None
+        self.notifies = False  # The module publishes SAMPLE_SEQ
+        self.pollable = True   # poll() waits for samples; cleared if it proves not to
+        self.polled = False    # The last wait() was a poll() that fired
+        self.seq = None        # SAMPLE_SEQ (or LAST_UPDATE stamps) last returned
+
+    def open(self):
+        self.file = open(self.proc_file, 'r')
+        self.poller = select.poll()
+        self.poller.register(self.file, select.POLLIN)
+
+    def close(self):
+        if self.file:
+            self.file.close()
+        self.file = None
+        self.poller = None
+
+    def wait(self, timeout):
+        """Block up to timeout seconds; True when a new sample may be readable"""
+        if self.seq is None:
+            return True  # Nothing read yet
+        if self.notifies and self.pollable and self.file:
+            try:
+                self.polled = bool(self.poller.poll(timeout * 1000))
+            except InterruptedError:
+                self.polled = False
+            return self.polled
+        time.sleep(timeout)
+        return True
+
+    def read(self):
+        """The flat proc data if it holds a new sample, else None. Raises OSError."""
+        try:
+            if not self.file:
+                self.open()
+            self.file.seek(0)
+            data = parse_proc(self.file.read())
+        except OSError:
+            self.close()  # Reopened next time, e.g. after a module reload
+            raise
+
+        seq = data.get('SAMPLE_SEQ')
+        self.notifies = seq is not None
+        if seq is None:
+            seq = tuple(value for key, value in data.items()
+                        if key.startswith('GPU_') and key.endswith('_LAST_UPDATE'))
+        polled, self.polled = self.polled, False
+        if seq == self.seq:
+            if polled:
+                self.pollable = False  # Ready without a new sample: poll() cannot wait here
+            return None
+        self.seq = seq
+        return data
@@ -2,17 +2,24 @@
 """
 Simple Real-time GPU Monitor Graph
 Creates live updating graphs for GPU metrics
+Redraws only when the module has taken a new sample
 """
 import time
 import matplotlib.pyplot as plt
-import matplotlib.animation as animation
 from collections import deque
 import numpy as np
+from gpu_proc_watch import ProcWatcher
+
+# How often the GUI loop checks for a new sample (no redraw unless there is one)
+CHECK_INTERVAL_MS = 250
+# Modules without SAMPLE_SEQ cannot be polled; their file is re-read at most this often (s)
+FALLBACK_INTERVAL = 1.0
 
 class SimpleGPUMonitor:
     def __init__(self, proc_file="/proc/gpu_monitor", max_points=50):
         self.proc_file = proc_file
         self.max_points = max_points
+        self.watcher = ProcWatcher(proc_file)
         
         # Data storage
         self.times = deque(maxlen=max_points)
@@ -30,28 +37,30 @@ class SimpleGPUMonitor:
             self.power_usage.append(0)
         
         self.start_time = time.time()
+        self.last_read = 0.0
         
     def read_gpu_data(self):
-        """Read GPU data from proc file"""
+        """Read GPU data from proc file; None if no new sample was taken"""
         try:
-            with open(self.proc_file, 'r') as f:
-                lines = f.readlines()
-            
-            data = {}
-            for line in lines:
-                line = line.strip()
-                if ':' in line:
-                    key, value = line.split(':', 1)
-                    data[key.strip()] = value.strip()
-            
-            return data
+            return self.watcher.read()
         except Exception as e:
             print(f"Error reading {self.proc_file}: {e}")
             return {}
     
     def update_data(self):
-        """Update data collections with new readings"""
+        """Update data collections with new readings; False if nothing changed"""
+        if self.watcher.notifies and self.watcher.pollable:
+            if not self.watcher.wait(0):
+                return False
+        else:
+            # No poll() wakeups: keep to the old once-a-second read
+            now = time.monotonic()
+            if now - self.last_read < FALLBACK_INTERVAL:
+                return False
+            self.last_read = now
         data = self.read_gpu_data()
+        if data is None:
+            return False
         current_time = time.time() - self.start_time
         
         self.times.append(current_time)
@@ -69,6 +78,7 @@ class SimpleGPUMonitor:
         self.gpu_utilization.append(util)
         self.memory_used.append(mem)
         self.power_usage.append(power)
+        return True
 
 class RealTimeGraphs:
     def __init__(self):
@@ -113,10 +123,14 @@ class RealTimeGraphs:
         
         plt.tight_layout()
         
-    def animate(self, frame):
-        """Animation function called by matplotlib"""
-        self.monitor.update_data()
-        
+    def check_for_sample(self):
+        """Timer callback: redraw only when the module has a new sample"""
+        if self.monitor.update_data():
+            self.animate()
+            self.fig.canvas.draw_idle()
+    
+    def animate(self):
+        """Update the lines from the monitor's data"""
         times = list(self.monitor.times)
         
         # Update temperature plot
@@ -146,10 +160,10 @@ class RealTimeGraphs:
         print("Starting real-time GPU monitoring...")
         print("Close the window or press Ctrl+C to stop")
         
-        # Create animation with 1000ms interval (1 second)
-        self.ani = animation.FuncAnimation(
-            self.fig, self.animate, interval=1000, blit=False, cache_frame_data=False
-        )
+        # Check for new samples; unlike an animation this draws nothing while idle
+        self.timer = self.fig.canvas.new_timer(interval=CHECK_INTERVAL_MS)
+        self.timer.add_callback(self.check_for_sample)
+        self.timer.start()
         
         try:
             plt.show()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+GPU Telemetry Recordings
+Append-only session files written by gpu_collector.py --record and read
+back by the exporters.
+
+A recording is a magic line followed by frames in the collector's wire
+framing (gpu_collector_protocol.FRAME_HEADER): one MSG_SCHEMA record, then
+full-width MSG_SAMPLE records interleaved with MSG_ANNOTATION and MSG_ALERT
+events as they happen. Records are appended as they occur, so a crashed or
+still-running session is readable up to its last complete frame.
+"""
+import json
+import math
+import time
+
+from gpu_collector_protocol import (
+    FRAME_HEADER, MAX_FRAME_SIZE, MSG_SCHEMA, MSG_SAMPLE, MSG_ANNOTATION,
+    MSG_ALERT, encode_frame, encode_json, sample_struct,
+)
+
+RECORDING_MAGIC = b'GPUREC1\n'
+READ_CHUNK_SIZE = 1024 * 1024
+
+# Clock of every timestamp_ns in a recording
+RECORDING_CLOCK = 'CLOCK_MONOTONIC'
+
+
+class Recorder:
+    """Streams samples and events of one session to a recording file"""
+
+    def __init__(self, path, schema, flush_interval=1.0):
+        self.path = path
+        self.file = open(path, 'wb')
+        self.flush_interval = flush_interval
+        self.last_flush = time.monotonic()
+        self.samples = 0
+
+        columns = len(schema['gpus']) * len(schema['metrics'])
+        self.format = sample_struct(columns)
+        header = dict(schema)
+        header['clock'] = RECORDING_CLOCK
+        # Lets readers map monotonic stamps to wall-clock time
+        header['realtime_offset_ns'] = time.time_ns() - time.monotonic_ns()
+        self.file.write(RECORDING_MAGIC)
+        self.file.write(encode_json(MSG_SCHEMA, header))
+
+    def _written(self):
+        now = time.monotonic()
+        if now - self.last_flush >= self.flush_interval:
+            self.file.flush()
+            self.last_flush = now
+
+    def write_sample(self, sample):
+        self.file.write(encode_frame(MSG_SAMPLE, self.format.pack(
+            sample.seq, sample.timestamp_ns, *sample.values)))
+        self.samples += 1
+        self._written()
+
+    def annotate(self, text, gpu=None, timestamp_ns=None):
+        """Free-form marker, e.g. 'benchmark started'; gpu=None is global"""
+        self.file.write(encode_json(MSG_ANNOTATION, {
+            'timestamp_ns': timestamp_ns or time.monotonic_ns(),
+            'text': str(text), 'gpu': gpu,
+        }))
+        self._written()
+
+    def alert(self, rule, gpu, metric, value, state, timestamp_ns=None):
+        """Alert transition; state is 'firing' or 'resolved'"""
+        self.file.write(encode_json(MSG_ALERT, {
+            'timestamp_ns': timestamp_ns or time.monotonic_ns(),
+            'rule': rule, 'gpu': gpu, 'metric': metric,
+            'value': None if value is None or math.isnan(value) else value,
+            'state': state,
+        }))
+        self._written()
+
+    def close(self):
+        if self.file is not None:
+            self.file.close()
+            self.file = None
+
+
+class RecordingReader:
+    """
+    Streaming reader: records are decoded chunk by chunk, so a multi-hour
+    recording is never held in memory.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.file = open(path, 'rb')
+        if self.file.read(len(RECORDING_MAGIC)) != RECORDING_MAGIC:
+            self.file.close()
+            raise ValueError(f"{path} is not a GPU telemetry recording")
+
+        self.buffer = bytearray()
+        self.offset = 0
+        records = self._frames()
+        try:
+            msg_type, payload = next(records)
+        except StopIteration:
+            msg_type = None
+        if msg_type != MSG_SCHEMA:
+            raise ValueError(f"{path} does not start with a schema record")
+        self.schema = json.loads(payload)
+        self.metrics = self.schema['metrics']
+        self.gpus = self.schema['gpus']
+        self.format = sample_struct(len(self.gpus) * len(self.metrics))
+        self._records = records
+
+    def _frames(self):
+        """Yield (type, payload) per complete frame; a torn tail is ignored"""
+        header_size = FRAME_HEADER.size
+        while True:
+            if len(self.buffer) - self.offset < header_size:
+                if not self._fill():
+                    return
+                continue
+            msg_type, _flags, length = FRAME_HEADER.unpack_from(self.buffer, self.offset)
+            if length > MAX_FRAME_SIZE:
+                raise ValueError(f"corrupt record of {length} bytes in {self.path}")
+            end = self.offset + header_size + length
+            if len(self.buffer) < end:
+                if not self._fill():
+                    return
+                continue
+            payload = self.buffer[self.offset + header_size:end]
+            self.offset = end
+            yield msg_type, payload
+
+    def _fill(self):
+        chunk = self.file.read(READ_CHUNK_SIZE)
+        if not chunk:
+            return False
+        del self.buffer[:self.offset]
+        self.offset = 0
+        self.buffer += chunk
+        return True
+
+    def records(self):
+        """
+        Yield ('sample', (seq, timestamp_ns, values)),
+        ('annotation', dict) and ('alert', dict) in recording order.
+        values is flat, indexed gpu * len(metrics) + metric.
+        """
+        unpack = self.format.unpack
+        for msg_type, payload in self._records:
+            if msg_type == MSG_SAMPLE:
+                fields = unpack(payload)
+                yield 'sample', (fields[0], fields[1], fields[2:])
+            elif msg_type == MSG_ANNOTATION:
+                yield 'annotation', json.loads(payload)
+            elif msg_type == MSG_ALERT:
+                yield 'alert', json.loads(payload)
+
+    def sample_payloads(self):
+        """Raw MSG_SAMPLE payloads (self.format) in order, for bulk decoding"""
+        size = self.format.size
+        for msg_type, payload in self._records:
+            if msg_type == MSG_SAMPLE and len(payload) == size:
+                yield payload
+
+    def close(self):
+        self.file.close()
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+GPU Quantile Sketches
+DDSketch (Masson et al., VLDB 2019): values are counted in logarithmic
+buckets whose width grows with the value, so any quantile is answered
+within a relative error alpha of the true value. Sketches with the same
+alpha merge by adding bucket counts, which is what lets node collectors
+summarize each window per GPU and metric, and the aggregator combine them
+per rack and fleet without ever seeing the raw samples.
+
+Serialized form (little endian): SKETCH_HEADER (alpha f64, zero count u64),
+then the positive and the negative store, each STORE_HEADER (first bucket
+key i32, bucket count u32) followed by that many u32 counts.
+"""
+import math
+import struct
+
+DEFAULT_ALPHA = 0.01
+# Beyond this many buckets per store, the lowest ones are collapsed
+MAX_BUCKETS = 2048
+# Magnitudes below this count as zero
+MIN_VALUE = 1e-9
+
+SKETCH_HEADER = struct.Struct('<dQ')
+STORE_HEADER = struct.Struct('<iI')
+
+
+class _Store:
+    """Bucket counts by key; key k holds values in (gamma^(k-1), gamma^k]"""
+    __slots__ = ('counts', 'total')
+
+    def __init__(self):
+        self.counts = {}
+        self.total = 0
+
+    def add(self, key, count=1):
+        counts = self.counts
+        counts[key] = counts.get(key, 0) + count
+        self.total += count
+        if len(counts) > MAX_BUCKETS:
+            self._collapse()
+
+    def _collapse(self):
+        """Fold the lowest buckets into one, losing accuracy only at the low end"""
+        keys = sorted(self.counts)
+        excess = keys[:len(keys) - MAX_BUCKETS + 1]
+        folded = sum(self.counts.pop(key) for key in excess)
+        target = keys[len(excess)]
+        self.counts[target] += folded
+
+    def merge(self, other):
+        counts = self.counts
+        for key, count in other.counts.items():
+            counts[key] = counts.get(key, 0) + count
+        self.total += other.total
+        if len(counts) > MAX_BUCKETS:
+            self._collapse()
+
+    def key_at_rank(self, rank, descending=False):
+        """Key of the bucket holding the rank-th value (0 based)"""
+        seen = 0
+        for key in sorted(self.counts, reverse=descending):
+            seen += self.counts[key]
+            if seen > rank:
+                return key
+        return key
+
+    def pack(self):
+        if not self.counts:
+            return STORE_HEADER.pack(0, 0)
+        low = min(self.counts)
+        length = max(self.counts) - low + 1
+        dense = [0] * length
+        for key, count in self.counts.items():
+            dense[key - low] = count
+        return STORE_HEADER.pack(low, length) + struct.pack(f'<{length}I', *dense)
+
+    def unpack(self, data, offset):
+        low, length = STORE_HEADER.unpack_from(data, offset)
+        offset += STORE_HEADER.size
+        dense = struct.unpack_from(f'<{length}I', data, offset)
+        for i, count in enumerate(dense):
+            if count:
+                self.counts[low + i] = count
+                self.total += count
+        return offset + 4 * length
+
+
+class DDSketch:
+    """Mergeable quantile sketch with relative accuracy alpha"""
+    __slots__ = ('alpha', 'gamma_log', 'positive', 'negative', 'zero')
+
+    def __init__(self, alpha=DEFAULT_ALPHA):
+        self.alpha = alpha
+        self.gamma_log = math.log((1 + alpha) / (1 - alpha))
+        self.positive = _Store()
+        self.negative = _Store()
+        self.zero = 0
+
+    @property
+    def count(self):
+        return self.positive.total + self.negative.total + self.zero
+
+    def add(self, value):
+        """Count one value; NaN is ignored"""
+        if value > MIN_VALUE:
+            self.positive.add(math.ceil(math.log(value) / self.gamma_log))
+        elif value < -MIN_VALUE:
+            self.negative.add(math.ceil(math.log(-value) / self.gamma_log))
+        elif value == value:
+            self.zero += 1
+
+    def merge(self, other):
+        if other.alpha != self.alpha:
+            raise ValueError(f"cannot merge sketches with alpha {other.alpha} and {self.alpha}")
+        self.positive.merge(other.positive)
+        self.negative.merge(other.negative)
+        self.zero += other.zero
+
+    def _value(self, key):
+        # Midpoint (in relative terms) of bucket key: within alpha of every value in it
+        return 2 * math.exp(key * self.gamma_log) / (1 + math.exp(self.gamma_log))
+
+    def quantile(self, q):
+        """Value at quantile q (0..1) within relative error alpha; None when empty"""
+        count = self.count
+        if not count:
+            return None
+        rank = int(q * (count - 1))
+        if rank < self.negative.total:
+            return -self._value(self.negative.key_at_rank(rank, descending=True))
+        rank -= self.negative.total
+        if rank < self.zero:
+            return 0.0
+        return self._value(self.positive.key_at_rank(rank - self.zero))
+
+    def to_bytes(self):
+        return SKETCH_HEADER.pack(self.alpha, self.zero) + self.positive.pack() + self.negative.pack()
+
+    @classmethod
+    def from_bytes(cls, data, offset=0):
+        """(sketch, offset after it)"""
+        alpha, zero = SKETCH_HEADER.unpack_from(data, offset)
+        sketch = cls(alpha)
+        sketch.zero = zero
+        offset = sketch.positive.unpack(data, offset + SKETCH_HEADER.size)
+        offset = sketch.negative.unpack(data, offset)
+        return sketch, offset
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Sysfs Source Resolution
+Resolves glob patterns for sysfs/procfs values once (and again on hotplug),
+keeps the chosen files open and re-reads them with seek(0), so a monitor
+tick costs a handful of reads instead of directory scans.
+"""
+import glob
+import socket
+import time
+
+# Intel GPU frequency sources, in order of preference
+INTEL_GPU_FREQUENCY_PATTERNS = [
+    "/sys/class/drm/card*/gt/gt0/rps_cur_freq_mhz",
+    "/sys/class/drm/card*/gt_cur_freq_mhz",
+    "/sys/class/drm/card*/device/gt_cur_freq_mhz",
+]
+
+# CPU temperature sources (proxy for integrated GPU temperature)
+CPU_TEMPERATURE_PATTERNS = [
+    "/sys/class/hwmon/hwmon*/temp*_input",
+    "/sys/class/thermal/thermal_zone*/temp",
+]
+
+NETLINK_KOBJECT_UEVENT = 15
+HOTPLUG_SUBSYSTEMS = (b'SUBSYSTEM=drm', b'SUBSYSTEM=hwmon', b'SUBSYSTEM=thermal')
+
+
+class SysfsValue:
+    """The first readable integer file among a list of glob patterns"""
+
+    def __init__(self, patterns):
+        self.patterns = patterns
+        self.path = None
+        self.file = None
+
+    def resolve(self):
+        """Scan the patterns and keep the first file that reads as an integer"""
+        self.close()
+        for pattern in self.patterns:
+            for path in sorted(glob.glob(pattern)):
+                try:
+                    f = open(path, 'r')
+                except OSError:
+                    continue
+                try:
+                    int(f.read().strip())
+                except (OSError, ValueError):
+                    f.close()
+                    continue
+                self.path = path
+                self.file = f
+                return True
+        return False
+
+    def read(self):
+        """Re-read the resolved file; None if unresolved or the read failed"""
+        if self.file is None:
+            return None
+        try:
+            self.file.seek(0)
+            return int(self.file.read().strip())
+        except (OSError, ValueError):
+            # Device went away or the file changed meaning; wait for a rescan
+            self.close()
+            return None
+
+    def close(self):
+        if self.file is not None:
+            try:
+                self.file.close()
+            except OSError:
+                pass
+        self.file = None
+        self.path = None
+
+
+class HotplugMonitor:
+    """Non-blocking kernel uevent listener, by default for drm/hwmon/thermal changes"""
+
+    def __init__(self, subsystems=HOTPLUG_SUBSYSTEMS):
+        self.subsystems = subsystems
+        try:
+            self.sock = socket.socket(socket.AF_NETLINK, socket.SOCK_DGRAM,
+                                      NETLINK_KOBJECT_UEVENT)
+            self.sock.bind((0, 1))
+            self.sock.setblocking(False)
+        except (OSError, AttributeError):
+            self.sock = None
+
+    def changed(self):
+        """Drain pending uevents; True if any concerned a monitored subsystem"""
+        if self.sock is None:
+            return False
+
+        changed = False
+        while True:
+            try:
+                event = self.sock.recv(8192)
+            except (BlockingIOError, InterruptedError):
+                break
+            except OSError:
+                # Receive buffer overflowed: events were lost, assume a change
+                changed = True
+                break
+            if any(subsystem in event for subsystem in self.subsystems):
+                changed = True
+        return changed
+
+    def close(self):
+        if self.sock is not None:
+            self.sock.close()
+            self.sock = None
+
+
+class SysfsSources:
+    """
+    Named SysfsValues resolved at startup. poll() once per tick re-resolves
+    everything after a hotplug event, and retries unresolved sources at
+    most every rescan_interval seconds.
+    """
+
+    def __init__(self, rescan_interval=60.0):
+        self.rescan_interval = rescan_interval
+        self.sources = {}
+        self.hotplug = HotplugMonitor()
+        self.last_scan = time.monotonic()
+
+    def add(self, name, patterns):
+        source = SysfsValue(patterns)
+        source.resolve()
+        self.sources[name] = source
+        return source
+
+    def poll(self):
+        now = time.monotonic()
+        if self.hotplug.changed():
+            for source in self.sources.values():
+                source.resolve()
+            self.last_scan = now
+        elif now - self.last_scan >= self.rescan_interval:
+            for source in self.sources.values():
+                if source.file is None:
+                    source.resolve()
+            self.last_scan = now
+
+    def read(self, name):
+        return self.sources[name].read()
+
+    def path(self, name):
+        return self.sources[name].path
+
+    def close(self):
+        for source in self.sources.values():
+            source.close()
+        self.hotplug.close()
@@ -1,48 +1,168 @@
 #!/usr/bin/env python3
 """
 Terminal-based Real-time GPU Monitor
-Displays live GPU metrics in the terminal with ASCII graphs
+Displays live GPU metrics in the terminal with ASCII graphs.
+Every GPU gets a compact row with its own trend history; rows adapt to the
+terminal size and can be sorted and filtered by metric. The screen is only
+redrawn when the module or collector has a new sample.
 """
-import time
-import os
+import argparse
+import re
+import shutil
 import sys
-from collections import deque
+import time
+from collections import defaultdict, deque
+from gpu_collector_protocol import CollectorClient
+from gpu_proc_watch import ProcWatcher
+
+# Metrics kept per GPU for the trend column
+TREND_METRICS = ['TEMPERATURE', 'UTILIZATION', 'MEMORY_USED', 'POWER_WATTS']
+
+# Short names accepted by --sort / --filter
+METRIC_ALIASES = {
+    'temp': 'TEMPERATURE',
+    'util': 'UTILIZATION',
+    'mem': 'MEMORY_USED',
+    'power': 'POWER_WATTS',
+    'clock': 'CLOCK_MHZ',
+    'fan': 'FAN_RPM',
+}
+
+FILTER_PATTERN = re.compile(r'^\s*(\w+)\s*(>=|<=|>|<|==|=)\s*(-?\d+(?:\.\d+)?)\s*$')
+FILTER_OPS = {
+    '>': lambda a, b: a > b, '<': lambda a, b: a < b,
+    '>=': lambda a, b: a >= b, '<=': lambda a, b: a <= b,
+    '=': lambda a, b: a == b, '==': lambda a, b: a == b,
+}
+
+# Longest wait for a sample before checking again
+WAIT_TIMEOUT = 1.0
+
+# Lines used by the header and footer around the GPU rows
+HEADER_LINES = 6
+FOOTER_LINES = 2
+
+CLEAR_SCREEN = '\033[H\033[J'
+
+
+def metric_name(name):
+    """Resolve 'util' / 'UTILIZATION' style names"""
+    return METRIC_ALIASES.get(name.lower(), name.upper())
+
+
+def parse_filter(text):
+    """'util>50' -> (metric, op, threshold)"""
+    match = FILTER_PATTERN.match(text)
+    if not match:
+        raise ValueError(f"bad filter '{text}' (expected e.g. util>50)")
+    name, op, threshold = match.groups()
+    return metric_name(name), FILTER_OPS[op], float(threshold)
+
 
 class TerminalGPUMonitor:
-    def __init__(self, proc_file="/proc/gpu_monitor", max_points=20):
+    def __init__(self, proc_file="/proc/gpu_monitor", max_points=20, refresh_rate=1.0,
+                 sort_by=None, filters=(), gpus=None):
         self.proc_file = proc_file
         self.max_points = max_points
+        self.refresh_rate = refresh_rate
+        self.sort_by = metric_name(sort_by) if sort_by and sort_by != 'index' else None
+        self.filters = [parse_filter(f) for f in filters]
+        self.gpu_filter = set(gpus) if gpus else None
+        
+        # Per-GPU trend histories, created on first sight of a GPU
+        self.history = defaultdict(lambda: {metric: deque([0.0] * max_points, maxlen=max_points)
+                                            for metric in TREND_METRICS})
+        
+        # Prefer the userspace collector: its history fills the trends at once
+        self.collector = self.connect_collector()
+        self.watcher = ProcWatcher(proc_file)
+    
+    def connect_collector(self):
+        """Subscribe to the collector if it is running, preloading its history"""
+        try:
+            client = CollectorClient(timeout=2)
+            client.subscribe(rate_hz=1.0 / self.refresh_rate, policy='coalesce',
+                             backfill_seconds=self.max_points * self.refresh_rate)
+        except (OSError, RuntimeError, ConnectionError):
+            return None
         
-        # Data storage for mini graphs
-        self.temperatures = deque(maxlen=max_points)
-        self.gpu_utilization = deque(maxlen=max_points)
-        self.memory_used = deque(maxlen=max_points)
-        self.power_usage = deque(maxlen=max_points)
-        
-        # Initialize with zeros
-        for _ in range(max_points):
-            self.temperatures.append(0)
-            self.gpu_utilization.append(0)
-            self.memory_used.append(0)
-            self.power_usage.append(0)
+        for seq, timestamp_ns, values in client.backfill:
+            self.record(self.snapshot(client.proc_data(values)))
+        return client
+    
+    def wait_for_sample(self, timeout):
+        """Block until the collector or module may have a new sample"""
+        if self.collector:
+            try:
+                return self.collector.wait(timeout)
+            except OSError:
+                return True  # read_gpu_data notices and falls back
+        return self.watcher.wait(timeout)
     
     def read_gpu_data(self):
-        """Read GPU data from proc file"""
+        """
+        Read GPU data from the collector, or the proc file without one.
+        None means no new sample since the last call.
+        """
+        if self.collector:
+            try:
+                samples = self.collector.poll_samples()
+            except (OSError, ConnectionError):
+                self.collector = None
+                return self.read_gpu_data()
+            if samples:
+                return self.collector.proc_data(samples[-1][2])
+            return None
+        
         try:
-            with open(self.proc_file, 'r') as f:
-                lines = f.readlines()
-            
-            data = {}
-            for line in lines:
-                line = line.strip()
-                if ':' in line:
-                    key, value = line.split(':', 1)
-                    data[key.strip()] = value.strip()
-            
-            return data
-        except Exception as e:
+            return self.watcher.read()
+        except OSError:
             return {}
     
+    def snapshot(self, data):
+        """Parse the flat key/value data once into one dict per GPU"""
+        try:
+            gpu_count = int(data.get('GPU_COUNT', '0'))
+        except ValueError:
+            gpu_count = 0
+        
+        gpus = []
+        for i in range(gpu_count):
+            prefix = f"GPU_{i}_"
+            gpu = {'index': i,
+                   'NAME': data.get(prefix + 'NAME', 'Unknown'),
+                   'DRIVER': data.get(prefix + 'DRIVER', 'Unknown')}
+            for metric in ('TEMPERATURE', 'UTILIZATION', 'MEMORY_USED', 'MEMORY_TOTAL',
+                           'POWER_WATTS', 'CLOCK_MHZ', 'FAN_RPM'):
+                try:
+                    gpu[metric] = float(data[prefix + metric])
+                except (KeyError, ValueError, TypeError):
+                    gpu[metric] = None
+            gpus.append(gpu)
+        return gpus
+    
+    def record(self, gpus):
+        """Append one reading of every GPU to its trend histories"""
+        for gpu in gpus:
+            history = self.history[gpu['index']]
+            for metric in TREND_METRICS:
+                history[metric].append(gpu[metric] or 0.0)
+    
+    def visible(self, gpus):
+        """Apply --gpus / --filter and --sort"""
+        rows = []
+        for gpu in gpus:
+            if self.gpu_filter is not None and gpu['index'] not in self.gpu_filter:
+                continue
+            if all(gpu.get(metric) is not None and op(gpu[metric], threshold)
+                   for metric, op, threshold in self.filters):
+                rows.append(gpu)
+        if self.sort_by:
+            # Highest first; GPUs without the metric go last
+            rows.sort(key=lambda gpu: (gpu.get(self.sort_by) is None,
+                                       -(gpu.get(self.sort_by) or 0)))
+        return rows
+    
     def create_bar_graph(self, values, width=20, max_val=None):
         """Create ASCII bar graph"""
         if not values or max(values) == 0:
@@ -55,7 +175,7 @@ class TerminalGPUMonitor:
             return '░' * width
         
         latest_val = values[-1]
-        filled = int((latest_val / max_val) * width)
+        filled = min(width, int((latest_val / max_val) * width))
         return '█' * filled + '░' * (width - filled)
     
     def create_spark_line(self, values, width=30):
@@ -85,81 +205,75 @@ class TerminalGPUMonitor:
         
         return result
     
-    def clear_screen(self):
-        """Clear terminal screen"""
-        os.system('clear' if os.name == 'posix' else 'cls')
+    def format_row(self, gpu, name_width, trend_metric, trend_width):
+        """One compact line per GPU"""
+        def value(metric, fmt, unit):
+            v = gpu[metric]
+            return f"{'—':>{len(fmt.format(0))}}{unit}" if v is None else f"{fmt.format(v)}{unit}"
+        
+        util = gpu['UTILIZATION']
+        line = (f"{gpu['index']:>2} {gpu['NAME'][:name_width]:<{name_width}} "
+                f"{value('TEMPERATURE', '{:3.0f}', '°C')} "
+                f"{value('UTILIZATION', '{:3.0f}', '%')} "
+                f"{self.create_bar_graph([util or 0], width=10, max_val=100)} "
+                f"{value('MEMORY_USED', '{:6.0f}', 'MB')} "
+                f"{value('POWER_WATTS', '{:4.0f}', 'W')} "
+                f"{value('CLOCK_MHZ', '{:5.0f}', 'MHz')}")
+        if trend_width > 0:
+            trend = list(self.history[gpu['index']][trend_metric])
+            line += f" {self.create_spark_line(trend, width=trend_width)}"
+        return line
+    
+    def render(self, gpus):
+        """Build the whole screen as one string"""
+        columns, lines = shutil.get_terminal_size((100, 30))
+        rows = self.visible(gpus)
+        trend_metric = self.sort_by if self.sort_by in TREND_METRICS else 'UTILIZATION'
+        
+        # Whatever the fixed columns leave is used for the trend
+        name_width = 22 if columns >= 100 else 12
+        header = (f"{'#':>2} {'Name':<{name_width}} {'Temp':>5} {'Util':>4} {'':10} "
+                  f"{'Memory':>8} {'Power':>5} {'Clock':>8}")
+        trend_width = max(0, min(self.max_points * 2, columns - len(header) - 1))
+        
+        out = ["🖥️  Real-time GPU Monitor",
+               "=" * min(columns, 100),
+               f"📅 {time.strftime('%Y-%m-%d %H:%M:%S')}   "
+               f"🔧 {'Collector' if self.collector else self.proc_file}   "
+               f"🔢 {len(rows)}/{len(gpus)} GPU(s)"
+               + (f"   ↕ {self.sort_by}" if self.sort_by else ""),
+               ""]
+        if trend_width > 0:
+            header += f" 📈 {trend_metric.lower()}"
+        out += [header, "-" * min(columns, len(header) + trend_width)]
+        
+        room = max(1, lines - HEADER_LINES - FOOTER_LINES)
+        shown = rows if len(rows) <= room else rows[:room - 1]
+        for gpu in shown:
+            out.append(self.format_row(gpu, name_width, trend_metric, trend_width)[:columns])
+        if len(shown) < len(rows):
+            out.append(f"   … {len(rows) - len(shown)} more GPU(s), enlarge the terminal or use --filter")
+        
+        out.append("")
+        out.append("Press Ctrl+C to stop monitoring...")
+        return '\n'.join(out)
     
     def display_data(self):
-        """Display current GPU data"""
+        """Display current GPU data; False if there was nothing new to show"""
         data = self.read_gpu_data()
+        if data is None:
+            return False
         
         if not data:
             print("❌ No GPU data available. Is the kernel module loaded?")
-            return
-        
-        self.clear_screen()
+            return True
         
-        # Update data collections
-        try:
-            temp = float(data.get('GPU_0_TEMPERATURE', '0'))
-            util = float(data.get('GPU_0_UTILIZATION', '0'))
-            mem = float(data.get('GPU_0_MEMORY_USED', '0'))
-            power = float(data.get('GPU_0_POWER_WATTS', '0'))
-        except (ValueError, TypeError):
-            temp = util = mem = power = 0
-        
-        self.temperatures.append(temp)
-        self.gpu_utilization.append(util)
-        self.memory_used.append(mem)
-        self.power_usage.append(power)
-        
-        # Header
-        print("🖥️  Real-time GPU Monitor")
-        print("=" * 60)
-        print(f"📅 {time.strftime('%Y-%m-%d %H:%M:%S')}")
-        print()
-        
-        # GPU Info
-        gpu_count = data.get('GPU_COUNT', '0')
-        print(f"🔢 GPU Count: {gpu_count}")
-        
-        if gpu_count != '0':
-            print(f"🏷️  GPU Name: {data.get('GPU_0_NAME', 'Unknown')}")
-            print(f"🚀 Driver: {data.get('GPU_0_DRIVER', 'Unknown')}")
-            print()
-            
-            # Current values with bars
-            print("📊 Current Metrics:")
-            print(f"🌡️  Temperature: {temp:6.1f}°C  {self.create_bar_graph([temp], max_val=100)}")
-            print(f"⚡ GPU Usage:   {util:6.1f}%   {self.create_bar_graph([util], max_val=100)}")
-            print(f"💾 Memory:      {mem:6.1f}MB  {self.create_bar_graph([mem], max_val=max(self.memory_used) if max(self.memory_used) > 0 else 1000)}")
-            print(f"🔋 Power:       {power:6.1f}W   {self.create_bar_graph([power], max_val=max(self.power_usage) if max(self.power_usage) > 0 else 100)}")
-            print()
-            
-            # Mini trend graphs
-            print("📈 Trends (last 20 readings):")
-            print(f"🌡️  Temp:  {self.create_spark_line(list(self.temperatures))}")
-            print(f"⚡ GPU:   {self.create_spark_line(list(self.gpu_utilization))}")
-            print(f"💾 Mem:   {self.create_spark_line(list(self.memory_used))}")
-            print(f"🔋 Power: {self.create_spark_line(list(self.power_usage))}")
-            print()
-            
-            # Additional info if available
-            memory_total = data.get('GPU_0_MEMORY_TOTAL', '0')
-            try:
-                mem_total = float(memory_total)
-                if mem_total > 0:
-                    mem_percent = (mem / mem_total) * 100
-                    print(f"💾 Memory Usage: {mem:.0f}MB / {mem_total:.0f}MB ({mem_percent:.1f}%)")
-            except (ValueError, TypeError):
-                pass
-            
-            clock_speed = data.get('GPU_0_CLOCK_MHZ', '0')
-            if clock_speed != '0':
-                print(f"⚡ Clock Speed: {clock_speed} MHz")
-        
-        print()
-        print("Press Ctrl+C to stop monitoring...")
+        # One parsed snapshot per tick feeds both the histories and the screen
+        gpus = self.snapshot(data)
+        self.record(gpus)
+        sys.stdout.write(CLEAR_SCREEN + self.render(gpus) + '\n')
+        sys.stdout.flush()
+        return True
     
     def run(self):
         """Run the terminal monitor"""
@@ -168,8 +282,11 @@ class TerminalGPUMonitor:
         
         try:
             while True:
-                self.display_data()
-                time.sleep(1)
+                # Idle until a sample arrives; --rate caps how often that redraws
+                if self.wait_for_sample(WAIT_TIMEOUT):
+                    started = time.monotonic()
+                    if self.display_data():
+                        time.sleep(max(0.0, self.refresh_rate - (time.monotonic() - started)))
         except KeyboardInterrupt:
             print("\n\n👋 Monitoring stopped by user")
         except Exception as e:
@@ -177,9 +294,26 @@ class TerminalGPUMonitor:
 
 def main():
     """Main entry point"""
+    parser = argparse.ArgumentParser(description="Terminal GPU monitor")
+    parser.add_argument('--rate', type=float, default=1.0,
+                        help="most refreshes per second (the screen only changes with new samples)")
+    parser.add_argument('--history', type=int, default=20, help="trend points per GPU")
+    parser.add_argument('--sort', default=None,
+                        help="sort by metric, highest first (temp, util, mem, power, clock, fan)")
+    parser.add_argument('--filter', action='append', default=[],
+                        help="only GPUs matching e.g. util>50 or temp>=80 (repeatable)")
+    parser.add_argument('--gpus', default=None, help="comma-separated GPU indices")
+    parser.add_argument('--proc-file', default="/proc/gpu_monitor")
+    args = parser.parse_args()
+    
     try:
-        monitor = TerminalGPUMonitor()
+        gpus = [int(g) for g in args.gpus.split(',')] if args.gpus else None
+        monitor = TerminalGPUMonitor(args.proc_file, max_points=args.history,
+                                     refresh_rate=1.0 / args.rate, sort_by=args.sort,
+                                     filters=args.filter, gpus=gpus)
         monitor.run()
+    except ValueError as e:
+        print(f"❌ {e}")
     except Exception as e:
         print(f"Error: {e}")
         print("Make sure the GPU monitor kernel module is loaded:")
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+GPU Topology
+Placement data for the collector's GPUs, read from sysfs once at discovery
+and again on hotplug: the PCI bridges above each GPU (from its resolved
+device path), NUMA node and local CPUs, PCIe link, xGMI hive membership
+(amdgpu), and for every pair of GPUs how they reach each other. The
+collector serves the result pre-encoded, so a launcher's query costs one
+socket round trip instead of a sysfs walk.
+
+Pair links use nvidia-smi topo's vocabulary, closest first:
+XGMI (peer link), PIX (one PCIe switch), PXB (several bridges, no host
+bridge), PHB (same PCI host bridge), NODE (same NUMA node), SYS.
+"""
+import os
+import re
+
+PCI_ADDRESS = re.compile(r'^[0-9a-f]{4}:[0-9a-f]{2}:[0-9a-f]{2}\.[0-7]$')
+HOST_BRIDGE = re.compile(r'^pci([0-9a-f]{4}:[0-9a-f]{2})$')
+
+# PCI bridge class (class >> 8)
+PCI_CLASS_BRIDGE_PCI = 0x0604
+
+LINK_XGMI = 'XGMI'
+LINK_PIX = 'PIX'
+LINK_PXB = 'PXB'
+LINK_PHB = 'PHB'
+LINK_NODE = 'NODE'
+LINK_SYS = 'SYS'
+LINK_SELF = 'X'
+
+LINK_LEGEND = [
+    (LINK_XGMI, "connected by AMD xGMI"),
+    (LINK_PIX, "through at most one PCIe switch"),
+    (LINK_PXB, "through several PCIe bridges, not the host bridge"),
+    (LINK_PHB, "through a PCI host bridge"),
+    (LINK_NODE, "across host bridges within a NUMA node"),
+    (LINK_SYS, "across NUMA nodes"),
+]
+
+
+def read_attr(path):
+    try:
+        with open(path, 'r') as f:
+            return f.read().strip()
+    except OSError:
+        return None
+
+
+def read_int(path, base=10, default=None):
+    text = read_attr(path)
+    try:
+        return int(text, base)
+    except (TypeError, ValueError):
+        return default
+
+
+def pci_ancestry(device_path):
+    """
+    (host bridge, [bridge addresses from the root port down]) of a device,
+    from the path sysfs resolves its bus/pci/devices link to
+    """
+    real = os.path.realpath(device_path)
+    parts = real.split(os.sep)
+    host = None
+    bridges = []
+    for i, part in enumerate(parts[:-1]):
+        match = HOST_BRIDGE.match(part)
+        if match:
+            host = match.group(1)
+            bridges = []
+        elif host is not None and PCI_ADDRESS.match(part):
+            path = os.sep.join(parts[:i + 1])
+            if read_int(os.path.join(path, 'class'), 16, 0) >> 8 == PCI_CLASS_BRIDGE_PCI:
+                bridges.append(part)
+    return host, bridges
+
+
+def describe_gpu(gpu):
+    """Per-GPU placement attributes"""
+    path = gpu.device_path
+    host, bridges = pci_ancestry(path)
+    hive = read_int(os.path.join(path, 'xgmi_hive_info', 'xgmi_hive_id'), default=0)
+    return {
+        'index': gpu.index,
+        'pci_address': gpu.pci_address,
+        'present': os.path.exists(os.path.join(path, 'vendor')),
+        'host_bridge': host,
+        'bridges': bridges,
+        'numa_node': read_int(os.path.join(path, 'numa_node'), default=-1),
+        'local_cpulist': read_attr(os.path.join(path, 'local_cpulist')),
+        'link': {
+            'speed': read_attr(os.path.join(path, 'current_link_speed')),
+            'width': read_int(os.path.join(path, 'current_link_width')),
+            'max_speed': read_attr(os.path.join(path, 'max_link_speed')),
+            'max_width': read_int(os.path.join(path, 'max_link_width')),
+        },
+        'xgmi_hive': hive or None,
+        'xgmi_node': read_int(os.path.join(path, 'xgmi_physical_id')) if hive else None,
+    }
+
+
+def pair_link(a, b):
+    """How GPU description a reaches b"""
+    if a['xgmi_hive'] is not None and a['xgmi_hive'] == b['xgmi_hive']:
+        return LINK_XGMI
+    if a['host_bridge'] is not None and a['host_bridge'] == b['host_bridge']:
+        common = 0
+        for x, y in zip(a['bridges'], b['bridges']):
+            if x != y:
+                break
+            common += 1
+        if common == 0:
+            return LINK_PHB
+        # Below the shared bridge, each side has only its switch port
+        if len(a['bridges']) - common <= 1 and len(b['bridges']) - common <= 1:
+            return LINK_PIX
+        return LINK_PXB
+    if a['numa_node'] >= 0 and a['numa_node'] == b['numa_node']:
+        return LINK_NODE
+    return LINK_SYS
+
+
+def shared_bridges(described):
+    """
+    Bridges with more than one GPU below them, each listed once as its
+    deepest bridge with that set of GPUs (a switch, not the ports above it)
+    """
+    members = {}
+    depth = {}
+    for gpu in described:
+        for level, bridge in enumerate(gpu['bridges']):
+            members.setdefault(bridge, []).append(gpu['index'])
+            depth[bridge] = level
+    deepest = {}
+    for bridge, gpus in members.items():
+        if len(gpus) < 2:
+            continue
+        key = tuple(gpus)
+        if key not in deepest or depth[bridge] > depth[deepest[key]]:
+            deepest[key] = bridge
+    return [{'bridge': bridge, 'root_port': depth[bridge] == 0, 'gpus': list(gpus)}
+            for gpus, bridge in sorted(deepest.items(), key=lambda item: item[1])]
+
+
+def build_topology(gpus):
+    """Topology of the collector's GPUs (objects with index, pci_address, device_path)"""
+    described = [describe_gpu(gpu) for gpu in gpus]
+    hives = {}
+    for gpu in described:
+        if gpu['xgmi_hive'] is not None:
+            hives.setdefault(gpu['xgmi_hive'], []).append(gpu['index'])
+    return {
+        'gpus': described,
+        'links': [[LINK_SELF if a is b else pair_link(a, b) for b in described]
+                  for a in described],
+        'switches': shared_bridges(described),
+        'xgmi_hives': [{'hive': hive, 'gpus': members} for hive, members in sorted(hives.items())],
+    }
+
+
+def format_matrix(topology):
+    """nvidia-smi topo -m style table"""
+    gpus = topology['gpus']
+    names = [f"GPU{gpu['index']}" for gpu in gpus]
+    width = max([len(name) for name in names] + [4]) + 1
+    lines = [' ' * width + ''.join(f"{name:<{width}}" for name in names)
+             + f"{'NUMA':<6}CPUs"]
+    for gpu, name, row in zip(gpus, names, topology['links']):
+        numa = gpu['numa_node'] if gpu['numa_node'] >= 0 else 'N/A'
+        lines.append(f"{name:<{width}}" + ''.join(f"{link:<{width}}" for link in row)
+                     + f"{numa!s:<6}{gpu['local_cpulist'] or 'N/A'}")
+    lines.append("")
+    lines += [f"  {link:<5} {meaning}" for link, meaning in LINK_LEGEND]
+    for switch in topology['switches']:
+        kind = 'root port' if switch['root_port'] else 'switch'
+        lines.append(f"  {kind} {switch['bridge']}: "
+                     + ', '.join(f"GPU{i}" for i in switch['gpus']))
+    return '\n'.join(lines)
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+GPU Trace Export
+Converts a collector recording (gpu_collector.py --record) into a Chrome
+JSON trace that Perfetto (ui.perfetto.dev) and chrome://tracing open
+directly: one process per GPU, one counter track per metric, annotations
+and alerts as instant events.
+
+Timestamps are the collector's CLOCK_MONOTONIC stamps in microseconds,
+the same clock Chrome and most Linux tracers use for trace_event time,
+so GPU tracks line up with application traces taken on the same host.
+The output is written event by event while the recording is read, so
+multi-hour sessions convert in constant memory.
+"""
+import argparse
+import gzip
+import json
+import math
+import sys
+
+from gpu_recording import RecordingReader
+
+# Keeps GPU "processes" clear of real PIDs when traces are viewed together
+GPU_PID_BASE = 1 << 20
+ANNOTATION_PID = GPU_PID_BASE - 1
+
+
+def trace_ts(timestamp_ns):
+    """Chrome trace timestamps are microseconds; keep ns precision"""
+    return f"{timestamp_ns // 1000}.{timestamp_ns % 1000:03d}"
+
+
+class ChromeTraceWriter:
+    """Writes a {"traceEvents": [...]} document one event at a time"""
+
+    def __init__(self, out):
+        self.out = out
+        self.count = 0
+        out.write('{"displayTimeUnit":"ms","traceEvents":[\n')
+
+    def event(self, obj, ts=None):
+        text = json.dumps(obj, separators=(',', ':'))
+        if ts is not None:
+            # Splice the preformatted timestamp in instead of a lossy float
+            text = f'{text[:-1]},"ts":{ts}}}'
+        if self.count:
+            self.out.write(',\n')
+        self.out.write(text)
+        self.count += 1
+
+    def close(self):
+        self.out.write('\n]}\n')
+
+
+def export(reader, out, gpus=None, metrics=None):
+    """Stream reader's records as Chrome trace events; returns event count"""
+    schema_metrics = reader.metrics
+    metric_count = len(schema_metrics)
+    gpus = [gpu['index'] for gpu in reader.gpus] if gpus is None else gpus
+    metrics = list(schema_metrics) if metrics is None else metrics
+
+    writer = ChromeTraceWriter(out)
+    for gpu in reader.gpus:
+        if gpu['index'] not in gpus:
+            continue
+        pid = GPU_PID_BASE + gpu['index']
+        writer.event({'ph': 'M', 'pid': pid, 'name': 'process_name',
+                      'args': {'name': f"GPU {gpu['index']}: {gpu['name']}"}})
+        writer.event({'ph': 'M', 'pid': pid, 'name': 'process_sort_index',
+                      'args': {'sort_index': gpu['index']}})
+    writer.event({'ph': 'M', 'pid': ANNOTATION_PID, 'name': 'process_name',
+                  'args': {'name': 'GPU annotations'}})
+
+    # (pid, metric name, flat slot) per exported track
+    tracks = [(GPU_PID_BASE + g, m, g * metric_count + schema_metrics.index(m))
+              for g in gpus for m in metrics]
+    last_values = {}
+    last_ts = None
+
+    for kind, record in reader.records():
+        if kind == 'sample':
+            _seq, timestamp_ns, values = record
+            ts = last_ts = trace_ts(timestamp_ns)
+            for pid, name, slot in tracks:
+                value = values[slot]
+                # Counter tracks hold their value: only changes are emitted
+                if math.isnan(value) or last_values.get(slot) == value:
+                    continue
+                last_values[slot] = value
+                writer.event({'ph': 'C', 'pid': pid, 'name': name,
+                              'args': {'value': value}}, ts)
+
+        elif kind == 'annotation':
+            gpu = record.get('gpu')
+            event = {'ph': 'i', 'cat': 'annotation', 'name': record['text'],
+                     'pid': ANNOTATION_PID if gpu is None else GPU_PID_BASE + gpu,
+                     'tid': 0, 's': 'g' if gpu is None else 'p'}
+            writer.event(event, trace_ts(record['timestamp_ns']))
+
+        elif kind == 'alert':
+            gpu = record.get('gpu')
+            event = {'ph': 'i', 'cat': 'alert',
+                     'name': f"{record['rule']} {record['state']}",
+                     'pid': ANNOTATION_PID if gpu is None else GPU_PID_BASE + gpu,
+                     'tid': 0, 's': 'p',
+                     'args': {'metric': record.get('metric'), 'value': record.get('value'),
+                              'state': record['state']}}
+            writer.event(event, trace_ts(record['timestamp_ns']))
+
+    # Close every counter track at the last sample instead of its last change
+    if last_ts is not None:
+        for pid, name, slot in tracks:
+            if slot in last_values:
+                writer.event({'ph': 'C', 'pid': pid, 'name': name,
+                              'args': {'value': last_values[slot]}}, last_ts)
+
+    writer.close()
+    return writer.count
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(description="Export a GPU recording as a Perfetto/Chrome trace")
+    parser.add_argument('recording', help="file written by gpu_collector.py --record")
+    parser.add_argument('-o', '--output', default=None,
+                        help="trace file (.json or .json.gz); default: recording name + .json")
+    parser.add_argument('--gpus', default=None, help="comma-separated GPU indices")
+    parser.add_argument('--metrics', default=None, help="comma-separated metric names")
+    args = parser.parse_args()
+
+    try:
+        reader = RecordingReader(args.recording)
+    except (OSError, ValueError) as e:
+        print(f"❌ {e}", file=sys.stderr)
+        sys.exit(1)
+
+    gpus = [int(g) for g in args.gpus.split(',')] if args.gpus else None
+    metrics = args.metrics.split(',') if args.metrics else None
+    for index in gpus or []:
+        if not 0 <= index < len(reader.gpus):
+            print(f"❌ Unknown GPU {index} (recording has {len(reader.gpus)})", file=sys.stderr)
+            sys.exit(1)
+    for name in metrics or []:
+        if name not in reader.metrics:
+            print(f"❌ Unknown metric {name} (available: {', '.join(reader.metrics)})",
+                  file=sys.stderr)
+            sys.exit(1)
+
+    output = args.output or args.recording + '.json'
+    if output.endswith('.gz'):
+        out = gzip.open(output, 'wt', encoding='utf-8')
+    else:
+        out = open(output, 'w', encoding='utf-8')
+    try:
+        count = export(reader, out, gpus, metrics)
+    finally:
+        out.close()
+        reader.close()
+    print(f"✅ Wrote {count} trace events to {output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""
+GPU Uncore Memory Bandwidth
+Integrated Intel GPUs share DRAM with the CPU, and memory bandwidth is
+usually what limits them, yet nothing in sysfs reports it. The memory
+controller's uncore PMU (uncore_imc*) counts the bytes it reads and
+writes; this backend opens those counters with perf_event_open once and
+turns their per-sample deltas into MB/s on the collector's Intel
+integrated GPUs:
+
+    MEMORY_READ_MBPS, MEMORY_WRITE_MBPS   all DRAM traffic (CPU + GPU + IO)
+    GT_MEMORY_MBPS                        GPU requests, on client PMUs that
+                                          count them separately (gt_requests)
+
+PMU, event encodings and scales are read from
+/sys/bus/event_source/devices like perf does. Clients from Alder Lake on
+have both uncore_imc_free_running_N and uncore_imc_N counting the same
+traffic, so only one family is summed: the free-running one when present.
+Each counter is opened on every CPU of its PMU's cpumask, i.e. once per
+socket on multi-socket servers. Uncore counters are system-wide, so
+opening them needs CAP_PERFMON (or root) or perf_event_paranoid <= 0.
+"""
+import ctypes
+import os
+import platform
+import struct
+
+EVENT_SOURCE_DIR = 'bus/event_source/devices'
+
+# PMU families, preferred first; they count the same DRAM traffic
+IMC_FAMILIES = ('uncore_imc_free_running', 'uncore_imc')
+
+PCI_VENDOR_ID_INTEL = 0x8086
+# Intel integrated graphics is always device 2 on the root bus
+INTEGRATED_GPU_SLOT = '00:02.0'
+
+UNCORE_METRICS = ['MEMORY_READ_MBPS', 'MEMORY_WRITE_MBPS', 'GT_MEMORY_MBPS']
+
+# Event names per metric, as named by the client, free-running and server IMC PMUs
+UNCORE_EVENTS = {
+    'MEMORY_READ_MBPS': ('data_reads', 'data_read', 'cas_count_read'),
+    'MEMORY_WRITE_MBPS': ('data_writes', 'data_write', 'cas_count_write'),
+    'GT_MEMORY_MBPS': ('gt_requests',),
+}
+
+MIB = 1024 * 1024
+
+# A count without a .scale file is one 64 byte cache line
+CACHE_LINE_MIB = 64.0 / MIB
+
+NR_PERF_EVENT_OPEN = {'x86_64': 298, 'i386': 336, 'i686': 336}
+PERF_FLAG_FD_CLOEXEC = 1 << 3
+PERF_ATTR_SIZE_VER0 = 64
+
+_COUNT = struct.Struct('<Q')
+
+
+class _PerfEventAttr(ctypes.Structure):
+    # PERF_ATTR_SIZE_VER0 layout of struct perf_event_attr
+    _fields_ = [('type', ctypes.c_uint32), ('size', ctypes.c_uint32),
+                ('config', ctypes.c_uint64), ('sample_period', ctypes.c_uint64),
+                ('sample_type', ctypes.c_uint64), ('read_format', ctypes.c_uint64),
+                ('flags', ctypes.c_uint64), ('wakeup_events', ctypes.c_uint32),
+                ('bp_type', ctypes.c_uint32), ('config1', ctypes.c_uint64)]
+
+
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+
+class UncoreError(RuntimeError):
+    pass
+
+
+def _read(path):
+    try:
+        with open(path, 'r') as f:
+            return f.read().strip()
+    except OSError:
+        return None
+
+
+def parse_cpumask(cpumask):
+    """'0,28' or '0-1' -> [0, 28] / [0, 1]"""
+    cpus = []
+    for part in cpumask.split(','):
+        low, _, high = part.strip().partition('-')
+        if low:
+            cpus.extend(range(int(low), int(high or low) + 1))
+    return cpus or [0]
+
+
+def imc_pmus(source_dir):
+    """PMU paths of the first IMC family present"""
+    try:
+        names = os.listdir(source_dir)
+    except OSError:
+        return []
+    for family in IMC_FAMILIES:
+        # uncore_imc_free_running_0 must not count as a uncore_imc PMU
+        pmus = [name for name in names if name == family or
+                (name.startswith(family + '_') and name[len(family) + 1:].isdigit())]
+        if pmus:
+            return sorted(os.path.join(source_dir, name) for name in pmus)
+    return []
+
+
+def encode_event(pmu_path, spec):
+    """'event=0xff,umask=0x20' -> {'config': ..., 'config1': ...} using the PMU's format files"""
+    fields = {'config': 0, 'config1': 0}
+    for term in spec.split(','):
+        name, _, value = term.partition('=')
+        value = int(value, 0) if value else 1
+        layout = _read(os.path.join(pmu_path, 'format', name.strip()))
+        if layout is None:
+            raise UncoreError(f"{os.path.basename(pmu_path)}: unknown event field '{name}'")
+        target, _, ranges = layout.partition(':')
+        if target not in fields:
+            raise UncoreError(f"{os.path.basename(pmu_path)}: unsupported field {layout}")
+        # Bits may be split over ranges, e.g. config:0-7,32-35
+        for bits in ranges.split(','):
+            low, _, high = bits.partition('-')
+            low = int(low)
+            width = int(high) - low + 1 if high else 1
+            fields[target] |= (value & ((1 << width) - 1)) << low
+            value >>= width
+    return fields
+
+
+class _Counter:
+    """One opened uncore event"""
+    __slots__ = ('fd', 'scale', 'last')
+
+    def __init__(self, fd, scale):
+        self.fd = fd
+        self.scale = scale      # MiB per count
+        self.last = None
+
+
+class UncoreIMCBackend:
+    """Samples IMC byte counters and publishes MB/s on Intel integrated GPUs"""
+
+    def __init__(self, sysfs_root='/sys'):
+        self.nr = NR_PERF_EVENT_OPEN.get(platform.machine())
+        if self.nr is None:
+            raise UncoreError(f"uncore IMC counters are not supported on {platform.machine()}")
+        self.pmus = imc_pmus(os.path.join(sysfs_root, EVENT_SOURCE_DIR))
+        if not self.pmus:
+            raise UncoreError("no uncore_imc PMU")
+
+        # Counters per metric, summed over channels/controllers and sockets
+        self.counters = {}
+        errors = []
+        for metric in UNCORE_METRICS:
+            counters = []
+            for pmu in self.pmus:
+                for event in UNCORE_EVENTS[metric]:
+                    try:
+                        opened = self._open(pmu, event)
+                    except UncoreError as e:
+                        errors.append(str(e))
+                        continue
+                    if opened:
+                        counters.extend(opened)
+                        break
+            if counters:
+                self.counters[metric] = counters
+        if not self.counters:
+            raise UncoreError(errors[0] if errors else "no IMC read/write events")
+
+        self.slots = []
+        self.last_ns = None
+
+    def _open(self, pmu, event):
+        """Open one event on one PMU, per CPU of its cpumask; None if the PMU does not have it"""
+        spec = _read(os.path.join(pmu, 'events', event))
+        if spec is None:
+            return None
+        pmu_type = _read(os.path.join(pmu, 'type'))
+        cpus = parse_cpumask(_read(os.path.join(pmu, 'cpumask')) or '0')
+
+        scale = _read(os.path.join(pmu, 'events', event + '.scale'))
+        scale = float(scale) if scale else CACHE_LINE_MIB
+        if (_read(os.path.join(pmu, 'events', event + '.unit')) or 'MiB') != 'MiB':
+            scale = CACHE_LINE_MIB
+
+        attr = _PerfEventAttr()
+        attr.type = int(pmu_type)
+        attr.size = PERF_ATTR_SIZE_VER0
+        fields = encode_event(pmu, spec)
+        attr.config = fields['config']
+        attr.config1 = fields['config1']
+
+        counters = []
+        for cpu in cpus:
+            fd = _libc.syscall(ctypes.c_long(self.nr), ctypes.byref(attr), ctypes.c_int(-1),
+                               ctypes.c_int(cpu), ctypes.c_int(-1),
+                               ctypes.c_ulong(PERF_FLAG_FD_CLOEXEC))
+            if fd < 0:
+                err = ctypes.get_errno()
+                for counter in counters:
+                    os.close(counter.fd)
+                raise UncoreError(f"perf_event_open {os.path.basename(pmu)}/{event}: "
+                                  f"{os.strerror(err)} (needs CAP_PERFMON or perf_event_paranoid <= 0)")
+            counters.append(_Counter(fd, scale))
+        return counters
+
+    @property
+    def metrics(self):
+        return [metric for metric in UNCORE_METRICS if metric in self.counters]
+
+    def attach(self, gpus, metric_index, metric_count):
+        """Publish on the Intel integrated GPUs; returns how many"""
+        self.slots = []
+        for gpu in gpus:
+            if (gpu.vendor_id != PCI_VENDOR_ID_INTEL
+                    or gpu.pci_address.split(':', 1)[-1] != INTEGRATED_GPU_SLOT):
+                continue
+            base = gpu.index * metric_count
+            self.slots.append({metric: base + metric_index[metric] for metric in self.counters})
+        return len(self.slots)
+
+    def sample(self, timestamp_ns, values):
+        """One read per counter; the first sample only sets the baselines"""
+        elapsed = (timestamp_ns - self.last_ns) / 1e9 if self.last_ns is not None else 0
+        self.last_ns = timestamp_ns
+        rates = {}
+        for metric, counters in self.counters.items():
+            mib = 0.0
+            valid = True
+            for counter in counters:
+                try:
+                    (count,) = _COUNT.unpack(os.read(counter.fd, _COUNT.size))
+                except OSError:
+                    counter.last = None
+                    valid = False
+                    continue
+                if counter.last is None or count < counter.last:
+                    valid = False  # First read, or the counter was reset
+                else:
+                    mib += (count - counter.last) * counter.scale
+                counter.last = count
+            if valid and elapsed > 0:
+                rates[metric] = mib * MIB / 1e6 / elapsed
+        for slots in self.slots:
+            for metric, rate in rates.items():
+                values[slots[metric]] = rate
+
+    def close(self):
+        for counters in self.counters.values():
+            for counter in counters:
+                os.close(counter.fd)
+        self.counters = {}
+        self.slots = []
+
+
+def load_uncore(sysfs_root='/sys', required=False):
+    """Opened IMC counters, or None; without required, unavailable just means none"""
+    try:
+        return UncoreIMCBackend(sysfs_root)
+    except UncoreError:
+        if required:
+            raise
+        return None
@@ -3,71 +3,53 @@
 Advanced GPU Hardware Monitor Viewer
 Reads real-time data from the GPU Monitor kernel module
 Supports multiple GPUs with dynamic discovery
+Redraws when the module or collector has a new sample
 """
 import sys
 import time
 import threading
 from collections import deque, defaultdict
-from datetime import datetime
+from datetime import datetime, timedelta
 import tkinter as tk
 from tkinter import ttk, messagebox
 import matplotlib.pyplot as plt
 from matplotlib.backends.backend_tkagg import FigureCanvasTkAgg
 from matplotlib.animation import FuncAnimation
 import numpy as np
+from gpu_collector_protocol import CollectorClient
+from gpu_proc_watch import ProcWatcher
+
+# Heatmap metrics: label -> (key, color scale low, high); a None high follows the data
+HEATMAP_METRICS = {
+    'Utilization (%)': ('UTILIZATION', 0, 100),
+    'Temperature (°C)': ('TEMPERATURE', 20, 100),
+    'Power (W)': ('POWER_WATTS', 0, None),
+    'Memory (MB)': ('MEMORY_USED', 0, None),
+}
+HEATMAP_COLUMNS = 120  # Samples kept per GPU row
+HEATMAP_SCALE_STEP = 50  # Data-following scales round up to this, so they rarely change
 
 class GPUMonitorReader:
     def __init__(self, proc_file="/proc/gpu_monitor"):
         self.proc_file = proc_file
         self.gpu_count = 0
         self.gpu_data = {}
+        self.watcher = ProcWatcher(proc_file)
+        self.last_data = None
+        self.sample_seq = None  # Changes with every new sample
         
+    def wait(self, timeout):
+        """Block until the module may have a new sample"""
+        return self.watcher.wait(timeout)
+    
     def read_gpu_data(self):
         """Read GPU data from kernel module"""
         try:
-            with open(self.proc_file, 'r') as f:
-                lines = f.readlines()
-            
-            data = {'global': {}, 'gpus': {}}
-            
-            for line in lines:
-                line = line.strip()
-                if not line or ':' not in line:
-                    continue
-                    
-                key, value = line.split(':', 1)
-                value = value.strip()
-                
-                # Global parameters
-                if key in ['GPU_COUNT', 'LAST_UPDATE', 'DATA_SOURCE', 'MODULE_VERSION']:
-                    data['global'][key] = value
-                    if key == 'GPU_COUNT':
-                        self.gpu_count = int(value)
-                
-                # GPU-specific parameters
-                elif key.startswith('GPU_'):
-                    parts = key.split('_', 2)
-                    if len(parts) >= 3:
-                        gpu_id = int(parts[1])
-                        param_name = '_'.join(parts[2:])
-                        
-                        if gpu_id not in data['gpus']:
-                            data['gpus'][gpu_id] = {}
-                        
-                        # Convert numeric values
-                        try:
-                            if param_name in ['VENDOR_ID', 'DEVICE_ID']:
-                                data['gpus'][gpu_id][param_name] = int(value, 16)
-                            elif param_name in ['MEMORY_USED', 'MEMORY_TOTAL', 'TEMPERATURE',
-                                              'CLOCK_CORE', 'CLOCK_MEMORY', 'POWER_USAGE',
-                                              'FAN_SPEED', 'UTILIZATION_GPU', 'UTILIZATION_MEMORY']:
-                                data['gpus'][gpu_id][param_name] = float(value)
-                            else:
-                                data['gpus'][gpu_id][param_name] = value
-                        except (ValueError, TypeError):
-                            data['gpus'][gpu_id][param_name] = value
-            
-            return data
+            flat = self.watcher.read()
+            if flat is not None:
+                self.last_data = self.parse(flat.items())
+                self.sample_seq = self.watcher.seq
+            return self.last_data
             
         except FileNotFoundError:
             print(f"Error: {self.proc_file} not found. Is the GPU monitor kernel module loaded?")
@@ -78,16 +60,91 @@ class GPUMonitorReader:
         except Exception as e:
             print(f"Error reading GPU data: {e}")
             return None
+    
+    def parse(self, items):
+        """Build the global/per-GPU structure from (key, value) pairs"""
+        data = {'global': {}, 'gpus': {}}
+        
+        for key, value in items:
+            # Global parameters
+            if key in ['GPU_COUNT', 'LAST_UPDATE', 'DATA_SOURCE', 'MODULE_VERSION',
+                       'PM_STATE', 'SUSPEND_COUNT', 'SUSPENDED_TOTAL_MS']:
+                data['global'][key] = value
+                if key == 'GPU_COUNT':
+                    self.gpu_count = int(value)
+            
+            # GPU-specific parameters
+            elif key.startswith('GPU_'):
+                parts = key.split('_', 2)
+                if len(parts) >= 3:
+                    gpu_id = int(parts[1])
+                    param_name = '_'.join(parts[2:])
+                    
+                    if gpu_id not in data['gpus']:
+                        data['gpus'][gpu_id] = {}
+                    
+                    # Convert numeric values
+                    try:
+                        if param_name in ['VENDOR_ID', 'DEVICE_ID']:
+                            data['gpus'][gpu_id][param_name] = int(value, 16)
+                        elif param_name in ['MEMORY_USED', 'MEMORY_TOTAL', 'TEMPERATURE',
+                                          'CLOCK_CORE', 'CLOCK_MEMORY', 'POWER_USAGE',
+                                          'FAN_SPEED', 'UTILIZATION_GPU', 'UTILIZATION_MEMORY',
+                                          'CLOCK_MHZ', 'POWER_WATTS', 'UTILIZATION', 'FAN_RPM']:
+                            data['gpus'][gpu_id][param_name] = float(value)
+                        else:
+                            data['gpus'][gpu_id][param_name] = value
+                    except (ValueError, TypeError):
+                        data['gpus'][gpu_id][param_name] = value
+    
+        return data
+
+class CollectorReader(GPUMonitorReader):
+    """Reads the same data structure from the userspace collector"""
+    def __init__(self, rate_hz=1.0, backfill_seconds=0):
+        super().__init__()
+        self.client = CollectorClient(timeout=2)
+        self.client.subscribe(rate_hz=rate_hz, policy='coalesce',
+                              backfill_seconds=backfill_seconds)
+    
+    def wait(self, timeout):
+        """Block until the collector sends something"""
+        try:
+            return self.client.wait(timeout)
+        except OSError:
+            return True  # read_gpu_data reports it
+    
+    def history(self):
+        """Backfilled samples as (datetime, data), oldest first"""
+        now = datetime.now()
+        now_ns = time.monotonic_ns()
+        return [(now - timedelta(seconds=(now_ns - timestamp_ns) / 1e9),
+                 self.parse(self.client.proc_data(values).items()))
+                for seq, timestamp_ns, values in self.client.backfill]
+    
+    def read_gpu_data(self):
+        """Latest sample received from the collector"""
+        try:
+            samples = self.client.poll_samples()
+        except (OSError, ConnectionError) as e:
+            print(f"Error reading from collector: {e}")
+            return None
+        if samples:
+            self.last_data = self.parse(self.client.proc_data(samples[-1][2]).items())
+            self.sample_seq = samples[-1][0]
+        return self.last_data
 
 class GPUMonitorGUI:
-    def __init__(self):
+    CARD_HEIGHT = 230  # Fixed, so the visible rows follow from the scroll offset
+    
+    def __init__(self, proc_file="/proc/gpu_monitor"):
         self.root = tk.Tk()
         self.root.title("Advanced GPU Hardware Monitor")
         self.root.geometry("1200x800")
         
-        self.reader = GPUMonitorReader()
         self.running = False
         self.update_thread = None
+        self.drawn_seq = None  # Sample shown on screen
         
         # Data storage for graphs
         self.history_length = 100
@@ -100,6 +157,15 @@ class GPUMonitorGUI:
             'timestamps': deque(maxlen=self.history_length)
         })
         
+        # Prefer the userspace collector, whose history fills the graphs at once
+        try:
+            self.reader = CollectorReader(rate_hz=1.0, backfill_seconds=self.history_length)
+            for timestamp, data in self.reader.history():
+                for gpu_id, gpu_data in data.get('gpus', {}).items():
+                    self.record_history(gpu_id, gpu_data, timestamp)
+        except (OSError, RuntimeError, ConnectionError):
+            self.reader = GPUMonitorReader(proc_file)
+        
         self.setup_ui()
         self.start_monitoring()
         
@@ -142,30 +208,64 @@ class GPUMonitorGUI:
         self.notebook.add(self.graphs_frame, text="Performance Graphs")
         self.setup_graphs_tab()
         
+        # Heatmap tab
+        self.heatmap_frame = ttk.Frame(self.notebook)
+        self.notebook.add(self.heatmap_frame, text="Heatmap")
+        self.setup_heatmap_tab()
+        
         # Details tab
         self.details_frame = ttk.Frame(self.notebook)
         self.notebook.add(self.details_frame, text="Detailed Info")
         self.setup_details_tab()
         
+        # Plots are only drawn while their tab shows
+        self.notebook.bind("<<NotebookTabChanged>>", lambda e: self.draw_visible_plots())
+        
     def setup_overview_tab(self):
         """Setup the overview tab with GPU cards"""
-        # Scrollable frame for GPU cards
-        canvas = tk.Canvas(self.overview_frame)
-        scrollbar = ttk.Scrollbar(self.overview_frame, orient="vertical", command=canvas.yview)
-        self.scrollable_frame = ttk.Frame(canvas)
+        # Only the cards inside the viewport exist; they are recycled while
+        # scrolling, so the tab costs the same with 4 or 64 GPUs
+        self.overview_canvas = tk.Canvas(self.overview_frame, highlightthickness=0,
+                                         yscrollincrement=self.CARD_HEIGHT // 4)
+        scrollbar = ttk.Scrollbar(self.overview_frame, orient="vertical",
+                                  command=self.overview_canvas.yview)
+        
+        def on_scroll(first, last):
+            scrollbar.set(first, last)
+            self.refresh_overview()
         
-        self.scrollable_frame.bind(
-            "<Configure>",
-            lambda e: canvas.configure(scrollregion=canvas.bbox("all"))
-        )
+        self.overview_canvas.configure(yscrollcommand=on_scroll)
+        self.overview_canvas.bind("<Configure>", self.on_overview_resize)
         
-        canvas.create_window((0, 0), window=self.scrollable_frame, anchor="nw")
-        canvas.configure(yscrollcommand=scrollbar.set)
+        # Wheel events go to the widget under the pointer, i.e. a card
+        self.overview_frame.bind("<Enter>", lambda e: self.bind_mousewheel(True))
+        self.overview_frame.bind("<Leave>", lambda e: self.bind_mousewheel(False))
         
-        canvas.pack(side="left", fill="both", expand=True)
+        self.overview_canvas.pack(side="left", fill="both", expand=True)
         scrollbar.pack(side="right", fill="y")
         
-        self.gpu_cards = {}
+        self.gpu_cards = []
+        self.overview_data = {}
+        self.overview_region = None
+        
+    def bind_mousewheel(self, enable):
+        """Scroll the overview with the wheel while the pointer is over it"""
+        for sequence in ("<MouseWheel>", "<Button-4>", "<Button-5>"):
+            if enable:
+                self.root.bind_all(sequence, self.on_mousewheel)
+            else:
+                self.root.unbind_all(sequence)
+    
+    def on_mousewheel(self, event):
+        """Wheel up/down (X11 buttons 4/5, delta elsewhere)"""
+        step = -1 if event.num == 4 or event.delta > 0 else 1
+        self.overview_canvas.yview_scroll(step, "units")
+    
+    def on_overview_resize(self, event):
+        """Cards span the canvas width"""
+        for card in self.gpu_cards:
+            self.overview_canvas.itemconfigure(card['window'], width=max(1, event.width - 10))
+        self.refresh_overview()
         
     def setup_graphs_tab(self):
         """Setup the performance graphs tab"""
@@ -203,6 +303,42 @@ class GPUMonitorGUI:
         self.canvas.draw()
         self.canvas.get_tk_widget().pack(fill=tk.BOTH, expand=True)
         
+    def setup_heatmap_tab(self):
+        """Setup the GPU x time heatmap tab"""
+        control_frame = ttk.Frame(self.heatmap_frame)
+        control_frame.pack(fill=tk.X)
+        
+        ttk.Label(control_frame, text="Metric:").pack(side=tk.LEFT, padx=5, pady=5)
+        self.heatmap_metric_var = tk.StringVar(value=next(iter(HEATMAP_METRICS)))
+        metric_box = ttk.Combobox(control_frame, textvariable=self.heatmap_metric_var,
+                                  values=list(HEATMAP_METRICS), state='readonly', width=20)
+        metric_box.pack(side=tk.LEFT, padx=5, pady=5)
+        metric_box.bind("<<ComboboxSelected>>", lambda e: self.draw_heatmap())
+        
+        # One preallocated metrics x GPUs x samples array; a new sample shifts
+        # it one column left, so the cost does not grow with history
+        self.heatmap = np.full((len(HEATMAP_METRICS), 0, HEATMAP_COLUMNS), np.nan)
+        self.heatmap_rows = []  # GPU id of each row
+        
+        self.heatmap_fig, self.heatmap_ax = plt.subplots(figsize=(12, 8))
+        colormap = plt.get_cmap('inferno').copy()
+        colormap.set_bad('lightgray')  # No reading
+        self.heatmap_image = self.heatmap_ax.imshow(
+            np.full((1, HEATMAP_COLUMNS), np.nan), aspect='auto', interpolation='nearest',
+            cmap=colormap, extent=(-HEATMAP_COLUMNS, 0, 1, 0), animated=True)
+        self.heatmap_colorbar = self.heatmap_fig.colorbar(self.heatmap_image, ax=self.heatmap_ax)
+        self.heatmap_ax.set_xlabel('Samples ago')
+        self.heatmap_ax.set_ylabel('GPU')
+        
+        self.heatmap_canvas = FigureCanvasTkAgg(self.heatmap_fig, self.heatmap_frame)
+        self.heatmap_canvas.get_tk_widget().pack(fill=tk.BOTH, expand=True)
+        
+        # The image is animated: full draws leave it out and on_heatmap_draw
+        # keeps that background, so a new sample only blits the image
+        self.heatmap_background = None
+        self.heatmap_scale = None
+        self.heatmap_canvas.mpl_connect('draw_event', self.on_heatmap_draw)
+        
     def setup_details_tab(self):
         """Setup the detailed information tab"""
         # Create treeview for detailed data
@@ -221,22 +357,25 @@ class GPUMonitorGUI:
         tree_scrollbar_y.pack(side="right", fill="y")
         tree_scrollbar_x.pack(side="bottom", fill="x")
         
-    def create_gpu_card(self, gpu_id, gpu_data):
-        """Create a card widget for a GPU"""
-        card_frame = ttk.LabelFrame(self.scrollable_frame, text=f"GPU {gpu_id}")
-        card_frame.pack(fill=tk.X, padx=5, pady=5)
+    def create_gpu_card(self):
+        """Create a card widget; refresh_overview binds it to a GPU"""
+        card_frame = ttk.LabelFrame(self.overview_canvas, text="")
+        card_frame.pack_propagate(False)
+        window = self.overview_canvas.create_window(
+            5, 5, window=card_frame, anchor="nw", state="hidden",
+            width=max(1, self.overview_canvas.winfo_width() - 10),
+            height=self.CARD_HEIGHT - 10)
         
         # Create grid for GPU info
         info_frame = ttk.Frame(card_frame)
         info_frame.pack(fill=tk.BOTH, expand=True, padx=10, pady=10)
         
-        # GPU name and basic info
-        name = gpu_data.get('NAME', 'Unknown GPU')
-        ttk.Label(info_frame, text=name, font=('TkDefaultFont', 10, 'bold')).grid(
-            row=0, column=0, columnspan=4, sticky=tk.W, pady=(0, 10))
-        
         # Create info labels
-        labels = {}
+        labels = {'frame': card_frame}
+        
+        # GPU name and basic info
+        labels['name'] = ttk.Label(info_frame, text="", font=('TkDefaultFont', 10, 'bold'))
+        labels['name'].grid(row=0, column=0, columnspan=4, sticky=tk.W, pady=(0, 10))
         
         # Temperature
         ttk.Label(info_frame, text="Temperature:").grid(row=1, column=0, sticky=tk.W, padx=(0, 5))
@@ -281,43 +420,87 @@ class GPUMonitorGUI:
         labels['mem_progress'] = ttk.Progressbar(progress_frame, maximum=100)
         labels['mem_progress'].pack(fill=tk.X, pady=(2, 0))
         
-        self.gpu_cards[gpu_id] = {
-            'frame': card_frame,
-            'labels': labels
+        card = {
+            'window': window,
+            'labels': labels,
+            'shown': {},       # Last value given to each widget
+            'position': None,  # Row the card is placed at
         }
+        self.gpu_cards.append(card)
+        return card
         
-    def update_gpu_card(self, gpu_id, gpu_data):
-        """Update GPU card with new data"""
-        if gpu_id not in self.gpu_cards:
-            self.create_gpu_card(gpu_id, gpu_data)
+    def show(self, card, key, option, value):
+        """Configure a card widget only when what it displays changes"""
+        if card['shown'].get(key) != value:
+            card['shown'][key] = value
+            card['labels'][key][option] = value
         
-        labels = self.gpu_cards[gpu_id]['labels']
+    def update_gpu_card(self, card, gpu_id, gpu_data):
+        """Update GPU card with new data"""
+        self.show(card, 'frame', 'text', f"GPU {gpu_id}")
+        self.show(card, 'name', 'text', gpu_data.get('NAME', 'Unknown GPU'))
         
         # Update temperature
         temp = gpu_data.get('TEMPERATURE', 0)
-        labels['temp'].config(text=f"{temp:.1f} °C")
+        self.show(card, 'temp', 'text', f"{temp:.1f} °C")
         
         # Update GPU utilization
         gpu_util = gpu_data.get('UTILIZATION_GPU', 0)
-        labels['gpu_util'].config(text=f"{gpu_util:.1f} %")
-        labels['gpu_progress']['value'] = gpu_util
+        self.show(card, 'gpu_util', 'text', f"{gpu_util:.1f} %")
+        self.show(card, 'gpu_progress', 'value', round(gpu_util, 1))
         
         # Update memory
         mem_used = gpu_data.get('MEMORY_USED', 0)
         mem_total = gpu_data.get('MEMORY_TOTAL', 1)
         mem_percent = (mem_used / mem_total * 100) if mem_total > 0 else 0
-        labels['memory'].config(text=f"{mem_used:.0f} / {mem_total:.0f} MB")
-        labels['mem_progress']['value'] = mem_percent
+        self.show(card, 'memory', 'text', f"{mem_used:.0f} / {mem_total:.0f} MB")
+        self.show(card, 'mem_progress', 'value', round(mem_percent, 1))
         
         # Update power
         power = gpu_data.get('POWER_USAGE', 0)
-        labels['power'].config(text=f"{power:.1f} W")
+        self.show(card, 'power', 'text', f"{power:.1f} W")
         
         # Update clocks
         core_clock = gpu_data.get('CLOCK_CORE', 0)
         mem_clock = gpu_data.get('CLOCK_MEMORY', 0)
-        labels['core_clock'].config(text=f"{core_clock:.0f} MHz")
-        labels['mem_clock'].config(text=f"{mem_clock:.0f} MHz")
+        self.show(card, 'core_clock', 'text', f"{core_clock:.0f} MHz")
+        self.show(card, 'mem_clock', 'text', f"{mem_clock:.0f} MHz")
+        
+    def refresh_overview(self):
+        """Place and fill the cards for the GPUs inside the viewport"""
+        canvas = self.overview_canvas
+        gpu_ids = sorted(self.overview_data)
+        
+        region = (0, 0, canvas.winfo_width(), len(gpu_ids) * self.CARD_HEIGHT)
+        if region != self.overview_region:
+            self.overview_region = region
+            canvas.configure(scrollregion=region)
+        
+        first = max(0, int(canvas.canvasy(0)) // self.CARD_HEIGHT)
+        count = max(0, min(len(gpu_ids) - first,
+                           canvas.winfo_height() // self.CARD_HEIGHT + 2))
+        while len(self.gpu_cards) < count:
+            self.create_gpu_card()
+        
+        # Row n always uses card n % pool size: scrolling by one row
+        # rebinds a single card instead of shifting every card's contents
+        pool = len(self.gpu_cards)
+        bound = set()
+        for position in range(first, first + count):
+            card = self.gpu_cards[position % pool]
+            bound.add(id(card))
+            if card['position'] != position:
+                if card['position'] is None:
+                    canvas.itemconfigure(card['window'], state="normal")
+                card['position'] = position
+                canvas.coords(card['window'], 5, position * self.CARD_HEIGHT + 5)
+            gpu_id = gpu_ids[position]
+            self.update_gpu_card(card, gpu_id, self.overview_data[gpu_id])
+        
+        for card in self.gpu_cards:
+            if id(card) not in bound and card['position'] is not None:
+                card['position'] = None
+                canvas.itemconfigure(card['window'], state="hidden")
         
     def update_graphs(self):
         """Update performance graphs"""
@@ -394,6 +577,74 @@ class GPUMonitorGUI:
         self.fig.tight_layout(pad=3.0)
         self.canvas.draw()
         
+    def resize_heatmap(self, gpu_ids):
+        """Give every GPU a row, keeping the history of known ones"""
+        heatmap = np.full((len(HEATMAP_METRICS), len(gpu_ids), HEATMAP_COLUMNS), np.nan)
+        old_rows = {gpu_id: row for row, gpu_id in enumerate(self.heatmap_rows)}
+        for row, gpu_id in enumerate(gpu_ids):
+            if gpu_id in old_rows:
+                heatmap[:, row] = self.heatmap[:, old_rows[gpu_id]]
+        self.heatmap = heatmap
+        self.heatmap_rows = gpu_ids
+        
+        rows = max(1, len(gpu_ids))
+        step = max(1, rows // 16)
+        self.heatmap_image.set_extent((-HEATMAP_COLUMNS, 0, rows, 0))
+        self.heatmap_ax.set_yticks([row + 0.5 for row in range(0, len(gpu_ids), step)])
+        self.heatmap_ax.set_yticklabels([str(gpu_id) for gpu_id in gpu_ids[::step]])
+        self.heatmap_scale = None  # Axes changed, needs a full draw
+    
+    def record_heatmap(self, gpus):
+        """Shift the heatmap one sample left and fill the newest column"""
+        gpu_ids = sorted(gpus)
+        if gpu_ids != self.heatmap_rows:
+            self.resize_heatmap(gpu_ids)
+        
+        self.heatmap[:, :, :-1] = self.heatmap[:, :, 1:]
+        for metric, (key, low, high) in enumerate(HEATMAP_METRICS.values()):
+            column = self.heatmap[metric, :, -1]
+            for row, gpu_id in enumerate(gpu_ids):
+                value = gpus[gpu_id].get(key)
+                column[row] = value if isinstance(value, float) else np.nan
+    
+    def draw_heatmap(self):
+        """Redraw the single heatmap image for the chosen metric"""
+        label = self.heatmap_metric_var.get()
+        key, low, high = HEATMAP_METRICS[label]
+        data = self.heatmap[list(HEATMAP_METRICS).index(label)]
+        if not data.size:
+            return
+        
+        if high is None:
+            peak = np.nanmax(data) if not np.isnan(data).all() else 0.0
+            high = HEATMAP_SCALE_STEP * (int(peak // HEATMAP_SCALE_STEP) + 1)
+        self.heatmap_image.set_data(data)
+        
+        if (label, low, high) != self.heatmap_scale or self.heatmap_background is None:
+            # Scale or axes changed: redraw everything, the colorbar included
+            self.heatmap_scale = (label, low, high)
+            self.heatmap_image.set_clim(low, high)
+            self.heatmap_colorbar.set_label(label)
+            self.heatmap_canvas.draw_idle()
+        else:
+            self.heatmap_canvas.restore_region(self.heatmap_background)
+            self.heatmap_ax.draw_artist(self.heatmap_image)
+            self.heatmap_canvas.blit(self.heatmap_ax.bbox)
+    
+    def on_heatmap_draw(self, event):
+        """After a full draw: keep the background and add the image"""
+        self.heatmap_background = self.heatmap_canvas.copy_from_bbox(self.heatmap_ax.bbox)
+        self.heatmap_ax.draw_artist(self.heatmap_image)
+        self.heatmap_canvas.blit(self.heatmap_ax.bbox)
+    
+    def draw_visible_plots(self):
+        """Draw the graphs or the heatmap when their tab is showing"""
+        selected = self.notebook.select()
+        if selected == str(self.graphs_frame):
+            self.update_graphs()
+        elif selected == str(self.heatmap_frame):
+            self.draw_heatmap()
+    
     def update_details_tree(self, data):
         """Update the detailed information tree"""
         # Clear existing items
@@ -424,6 +675,16 @@ class GPUMonitorGUI:
         for item in self.details_tree.get_children():
             self.details_tree.item(item, open=True)
     
+    def record_history(self, gpu_id, gpu_data, timestamp):
+        """Append one reading of a GPU to the graph history"""
+        history = self.gpu_history[gpu_id]
+        history['timestamps'].append(timestamp)
+        history['temperature'].append(gpu_data.get('TEMPERATURE', 0))
+        history['utilization_gpu'].append(gpu_data.get('UTILIZATION_GPU', 0))
+        history['utilization_memory'].append(gpu_data.get('UTILIZATION_MEMORY', 0))
+        history['power_usage'].append(gpu_data.get('POWER_USAGE', 0))
+        history['memory_used'].append(gpu_data.get('MEMORY_USED', 0))
+    
     def update_data(self):
         """Update all data and UI elements"""
         data = self.reader.read_gpu_data()
@@ -432,25 +693,26 @@ class GPUMonitorGUI:
             self.status_var.set("Error: Cannot read GPU data")
             return
         
+        # Nothing to redraw until the module or collector has a new sample
+        if self.reader.sample_seq == self.drawn_seq:
+            return
+        self.drawn_seq = self.reader.sample_seq
+        
         gpu_count = len(data.get('gpus', {}))
         self.status_var.set(f"Monitoring {gpu_count} GPU(s) - Last update: {datetime.now().strftime('%H:%M:%S')}")
         
-        # Update GPU cards
-        for gpu_id, gpu_data in data.get('gpus', {}).items():
-            self.update_gpu_card(gpu_id, gpu_data)
-            
-            # Store history for graphs
-            now = datetime.now()
-            history = self.gpu_history[gpu_id]
-            history['timestamps'].append(now)
-            history['temperature'].append(gpu_data.get('TEMPERATURE', 0))
-            history['utilization_gpu'].append(gpu_data.get('UTILIZATION_GPU', 0))
-            history['utilization_memory'].append(gpu_data.get('UTILIZATION_MEMORY', 0))
-            history['power_usage'].append(gpu_data.get('POWER_USAGE', 0))
-            history['memory_used'].append(gpu_data.get('MEMORY_USED', 0))
+        # Update the GPU cards in view
+        self.overview_data = data.get('gpus', {})
+        self.refresh_overview()
+        
+        # Store history for graphs
+        for gpu_id, gpu_data in self.overview_data.items():
+            self.record_history(gpu_id, gpu_data, datetime.now())
+        
+        self.record_heatmap(self.overview_data)
         
         # Update graphs
-        self.update_graphs()
+        self.draw_visible_plots()
         
         # Update details tree
         self.update_details_tree(data)
@@ -459,8 +721,10 @@ class GPUMonitorGUI:
         """Background monitoring loop"""
         while self.running:
             try:
-                self.root.after(0, self.update_data)
-                time.sleep(float(self.refresh_rate_var.get()))
+                # Sleep until a sample arrives; the refresh rate caps redraws
+                if self.reader.wait(1.0):
+                    self.root.after(0, self.update_data)
+                    time.sleep(float(self.refresh_rate_var.get()))
             except Exception as e:
                 print(f"Error in monitoring loop: {e}")
                 self.root.after(0, lambda: self.status_var.set(f"Error: {e}"))
@@ -512,7 +776,7 @@ def main():
         proc_file = "/proc/gpu_monitor"
     
     try:
-        app = GPUMonitorGUI()
+        app = GPUMonitorGUI(proc_file)
         print("Starting Advanced GPU Hardware Monitor...")
         print(f"Reading from: {proc_file}")
         print("Close the window or press Ctrl+C to exit")
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+"""
+GPU Web Dashboard
+HTTP + WebSocket endpoint run inside gpu_collector.py --serve --http PORT.
+
+GET /          static canvas dashboard (gpu_dashboard.html)
+GET /schema    collector schema as JSON
+GET /ws        WebSocket: schema as a text message, then binary frames
+
+Binary frames (little endian) are shared by every browser:
+    u8 kind (FRAME_KEY / FRAME_DELTA), u8 reserved, u16 count,
+    u32 seq, f64 monotonic seconds, then
+    FRAME_KEY:   count float32 values, one per slot (gpu * metrics + metric)
+    FRAME_DELTA: count (u16 slot, float32 value) pairs that changed
+A delta is encoded once per push and written to every browser; browsers
+that just connected or fell behind get a keyframe instead. Pushes are
+decimated to --web-rate, independently of the acquisition rate.
+"""
+import base64
+import hashlib
+import json
+import os
+import selectors
+import socket
+import struct
+from array import array
+from collections import deque
+
+DASHBOARD_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'gpu_dashboard.html')
+WEBSOCKET_GUID = b'258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+
+FRAME_KEY = 0
+FRAME_DELTA = 1
+FRAME_HEADER = struct.Struct('<BBHId')
+DELTA_ENTRY = struct.Struct('<Hf')
+
+KEYFRAME_INTERVAL = 60           # Pushes between keyframes for everyone
+MAX_REQUEST_SIZE = 16 * 1024
+MAX_PENDING_BYTES = 1024 * 1024  # A browser further behind is resynced with a keyframe
+
+WS_OP_TEXT = 0x1
+WS_OP_BINARY = 0x2
+WS_OP_CLOSE = 0x8
+WS_OP_PING = 0x9
+WS_OP_PONG = 0xA
+
+
+def ws_frame(opcode, payload):
+    """Unmasked server-to-client frame"""
+    length = len(payload)
+    if length < 126:
+        header = struct.pack('!BB', 0x80 | opcode, length)
+    elif length < 65536:
+        header = struct.pack('!BBH', 0x80 | opcode, 126, length)
+    else:
+        header = struct.pack('!BBQ', 0x80 | opcode, 127, length)
+    return header + payload
+
+
+def ws_parse(buffer):
+    """
+    Parse one client frame from buffer; returns (opcode, payload, consumed)
+    or None when incomplete. Client frames are always masked.
+    """
+    if len(buffer) < 2:
+        return None
+    opcode = buffer[0] & 0x0f
+    masked = buffer[1] & 0x80
+    length = buffer[1] & 0x7f
+    pos = 2
+    if length == 126:
+        if len(buffer) < 4:
+            return None
+        length = struct.unpack_from('!H', buffer, 2)[0]
+        pos = 4
+    elif length == 127:
+        if len(buffer) < 10:
+            return None
+        length = struct.unpack_from('!Q', buffer, 2)[0]
+        pos = 10
+    if length > MAX_REQUEST_SIZE:
+        raise ValueError("WebSocket message too large")
+    mask = b''
+    if masked:
+        mask = buffer[pos:pos + 4]
+        pos += 4
+    if len(buffer) < pos + length:
+        return None
+    payload = bytearray(buffer[pos:pos + length])
+    if masked:
+        for i in range(length):
+            payload[i] ^= mask[i & 3]
+    return opcode, bytes(payload), pos + length
+
+
+class WebClient:
+    """One HTTP connection; becomes a WebSocket after the upgrade"""
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.inbuf = bytearray()
+        self.queue = deque()      # Whole frames; only these may be dropped
+        self.queued_bytes = 0
+        self.current = b''        # Frame being written
+        self.offset = 0
+        self.websocket = False
+        self.synced = False       # Has the latest keyframe or every delta since
+        self.closing = False      # Close once everything is written
+        self.writing = False
+
+    def pending(self):
+        return bool(self.current) or bool(self.queue)
+
+    def flush(self):
+        """Write as much as the socket accepts; False if the peer is gone"""
+        while True:
+            if not self.current:
+                if not self.queue:
+                    return True
+                self.current = memoryview(self.queue.popleft())
+                self.queued_bytes -= len(self.current)
+                self.offset = 0
+            try:
+                sent = self.sock.send(self.current[self.offset:])
+            except (BlockingIOError, InterruptedError):
+                return True
+            except OSError:
+                return False
+            self.offset += sent
+            if self.offset < len(self.current):
+                return True
+            self.current = b''
+
+
+class WebDashboard:
+    """HTTP/WebSocket side of the collector; runs in its selector loop"""
+
+    def __init__(self, collector, selector, host='127.0.0.1', port=8080, rate_hz=2.0):
+        self.collector = collector
+        self.selector = selector
+        self.clients = {}
+        self.period_ns = int(1e9 / rate_hz) if rate_hz > 0 else 0
+        self.next_push_ns = 0
+        self.pushes = 0
+        self.last_values = None
+
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind((host, port))
+        self.listener.listen(64)
+        self.listener.setblocking(False)
+        self.address = self.listener.getsockname()
+        selector.register(self.listener, selectors.EVENT_READ, self._accept)
+
+        self.schema = json.dumps(collector.schema(), separators=(',', ':')).encode()
+        self.schema_message = ws_frame(WS_OP_TEXT, self.schema)
+        try:
+            with open(DASHBOARD_FILE, 'rb') as f:
+                self.page = f.read()
+        except OSError:
+            self.page = b'<h1>gpu_dashboard.html not found</h1>'
+
+    # -- connections ---------------------------------------------------------
+
+    def _accept(self, events):
+        try:
+            sock, _ = self.listener.accept()
+        except (BlockingIOError, InterruptedError):
+            return
+        sock.setblocking(False)
+        client = WebClient(sock)
+        self.clients[sock.fileno()] = client
+        self.selector.register(sock, selectors.EVENT_READ,
+                               lambda events, client=client: self._event(client, events))
+
+    def _drop(self, client):
+        if self.clients.pop(client.sock.fileno(), None) is None:
+            return
+        self.selector.unregister(client.sock)
+        client.sock.close()
+
+    def _event(self, client, events):
+        if events & selectors.EVENT_READ:
+            self._read(client)
+        if events & selectors.EVENT_WRITE and client.sock.fileno() in self.clients:
+            self._flush(client)
+
+    def _send(self, client, data):
+        client.queue.append(data)
+        client.queued_bytes += len(data)
+        self._flush(client)
+
+    def _flush(self, client):
+        if not client.flush() or (client.closing and not client.pending()):
+            self._drop(client)
+            return
+        writing = client.pending()
+        if writing != client.writing:
+            events = selectors.EVENT_READ | (selectors.EVENT_WRITE if writing else 0)
+            self.selector.modify(client.sock, events,
+                                 lambda events, client=client: self._event(client, events))
+            client.writing = writing
+
+    def _read(self, client):
+        try:
+            data = client.sock.recv(65536)
+        except (BlockingIOError, InterruptedError):
+            return
+        except OSError:
+            data = b''
+        if not data:
+            self._drop(client)
+            return
+        client.inbuf += data
+        try:
+            if client.websocket:
+                self._read_websocket(client)
+            else:
+                self._read_http(client)
+        except ValueError:
+            self._drop(client)
+
+    # -- HTTP ----------------------------------------------------------------
+
+    def _read_http(self, client):
+        end = client.inbuf.find(b'\r\n\r\n')
+        if end < 0:
+            if len(client.inbuf) > MAX_REQUEST_SIZE:
+                raise ValueError("request too large")
+            return
+        lines = bytes(client.inbuf[:end]).decode('latin-1').split('\r\n')
+        del client.inbuf[:end + 4]
+        parts = lines[0].split()
+        if len(parts) < 2 or parts[0] != 'GET':
+            self._respond(client, '405 Method Not Allowed', 'text/plain', b'GET only\n')
+            return
+        headers = {}
+        for line in lines[1:]:
+            name, _, value = line.partition(':')
+            headers[name.strip().lower()] = value.strip()
+        path = parts[1].split('?', 1)[0]
+
+        if path == '/ws' and headers.get('upgrade', '').lower() == 'websocket':
+            self._upgrade(client, headers)
+        elif path in ('/', '/index.html'):
+            self._respond(client, '200 OK', 'text/html; charset=utf-8', self.page)
+        elif path == '/schema':
+            self._respond(client, '200 OK', 'application/json', self.schema)
+        else:
+            self._respond(client, '404 Not Found', 'text/plain', b'not found\n')
+
+    def _respond(self, client, status, content_type, body):
+        client.closing = True
+        self._send(client, (f"HTTP/1.1 {status}\r\n"
+                            f"Content-Type: {content_type}\r\n"
+                            f"Content-Length: {len(body)}\r\n"
+                            "Cache-Control: no-store\r\n"
+                            "Connection: close\r\n\r\n").encode() + body)
+
+    def _upgrade(self, client, headers):
+        key = headers.get('sec-websocket-key')
+        if not key:
+            self._respond(client, '400 Bad Request', 'text/plain', b'missing key\n')
+            return
+        accept = base64.b64encode(hashlib.sha1(key.encode() + WEBSOCKET_GUID).digest())
+        client.websocket = True
+        self._send(client, b"HTTP/1.1 101 Switching Protocols\r\n"
+                           b"Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                           b"Sec-WebSocket-Accept: " + accept + b"\r\n\r\n")
+        self._send(client, self.schema_message)
+
+    # -- WebSocket -----------------------------------------------------------
+
+    def _read_websocket(self, client):
+        while True:
+            frame = ws_parse(client.inbuf)
+            if frame is None:
+                return
+            opcode, payload, consumed = frame
+            del client.inbuf[:consumed]
+            if opcode == WS_OP_CLOSE:
+                client.closing = True
+                self._send(client, ws_frame(WS_OP_CLOSE, payload[:2]))
+                return
+            if opcode == WS_OP_PING:
+                self._send(client, ws_frame(WS_OP_PONG, payload))
+            # The dashboard sends nothing else; other messages are ignored
+
+    def _keyframe(self, seq, timestamp_ns, values):
+        return ws_frame(WS_OP_BINARY, FRAME_HEADER.pack(
+            FRAME_KEY, 0, len(values), seq & 0xffffffff, timestamp_ns / 1e9)
+            + values.tobytes())
+
+    def due(self, timestamp_ns, tolerance_ns):
+        """Dashboard-rate decimation, as Subscriber.due in the collector"""
+        if timestamp_ns + tolerance_ns < self.next_push_ns:
+            return False
+        self.next_push_ns += self.period_ns
+        if self.next_push_ns <= timestamp_ns:
+            self.next_push_ns = timestamp_ns + self.period_ns  # Resync after a stall
+        return True
+
+    def publish(self, sample, tolerance_ns=0):
+        """Push the sample to browsers when the dashboard rate is due"""
+        if not self.due(sample.timestamp_ns, tolerance_ns):
+            return
+        values = array('f', sample.values)
+        previous = self.last_values
+        self.last_values = values
+
+        browsers = [c for c in self.clients.values() if c.websocket and not c.closing]
+        if not browsers:
+            return
+        self.pushes += 1
+        keyframe = None
+        delta = None
+        if previous is not None and self.pushes % KEYFRAME_INTERVAL:
+            changes = bytearray()
+            count = 0
+            for slot, (old, new) in enumerate(zip(previous, values)):
+                # NaN == NaN here: an absent metric is not a change
+                if old != new and (old == old or new == new):
+                    changes += DELTA_ENTRY.pack(slot, new)
+                    count += 1
+            delta = ws_frame(WS_OP_BINARY, FRAME_HEADER.pack(
+                FRAME_DELTA, 0, count, sample.seq & 0xffffffff,
+                sample.timestamp_ns / 1e9) + changes)
+
+        for client in browsers:
+            if client.queued_bytes > MAX_PENDING_BYTES:
+                # Too far behind: drop whole queued frames and resync
+                client.queue.clear()
+                client.queued_bytes = 0
+                client.synced = False
+            if delta is not None and client.synced:
+                self._send(client, delta)
+            else:
+                if keyframe is None:
+                    keyframe = self._keyframe(sample.seq, sample.timestamp_ns, values)
+                self._send(client, keyframe)
+                client.synced = True
+
+    def close(self):
+        for client in list(self.clients.values()):
+            self._drop(client)
+        self.selector.unregister(self.listener)
+        self.listener.close()
@@ -9,6 +9,7 @@ import time
 import re
 import os
 from collections import deque
+from gpu_sysfs_sources import SysfsSources, INTEL_GPU_FREQUENCY_PATTERNS, CPU_TEMPERATURE_PATTERNS
 import matplotlib.pyplot as plt
 import matplotlib.animation as animation
 
@@ -38,6 +39,11 @@ class RealIntelGPUMonitor:
         self.start_time = time.time()
         self.last_interrupt_count = 0
         self.last_interrupt_time = time.time()
+
+        # Resolve sysfs sources once; re-resolved on hotplug
+        self.sources = SysfsSources()
+        self.sources.add('gpu_frequency', INTEL_GPU_FREQUENCY_PATTERNS)
+        self.sources.add('cpu_temperature', CPU_TEMPERATURE_PATTERNS)
         
     def read_gpu_interrupt_rate(self):
         """Read Intel GPU interrupt rate from /proc/interrupts"""
@@ -80,54 +86,19 @@ class RealIntelGPUMonitor:
 
     def read_intel_gpu_frequency(self):
         """Read actual Intel GPU frequency"""
-        try:
-            # Try multiple frequency sources
-            freq_paths = [
-                "/sys/class/drm/card*/gt/gt0/rps_cur_freq_mhz",
-                "/sys/class/drm/card*/gt_cur_freq_mhz", 
-                "/sys/class/drm/card*/device/gt_cur_freq_mhz"
-            ]
-            
-            for pattern in freq_paths:
-                import glob
-                files = glob.glob(pattern)
-                for file_path in files:
-                    try:
-                        with open(file_path, 'r') as f:
-                            freq = int(f.read().strip())
-                            return freq
-                    except:
-                        continue
-            return 0
-        except:
-            return 0
+        freq = self.sources.read('gpu_frequency')
+        return freq if freq is not None else 0
     
     def read_cpu_temperature(self):
         """Read CPU temperature as proxy for integrated GPU temperature"""
-        try:
-            # Read from coretemp sensor
-            temp_paths = [
-                "/sys/class/hwmon/hwmon*/temp*_input",
-                "/sys/class/thermal/thermal_zone*/temp"
-            ]
-            
-            import glob
-            for pattern in temp_paths:
-                files = glob.glob(pattern)
-                for file_path in files:
-                    try:
-                        with open(file_path, 'r') as f:
-                            temp = int(f.read().strip())
-                            # Convert millidegrees to degrees, add offset for GPU
-                            if temp > 1000:
-                                return (temp // 1000) + 5  # GPU usually 5°C higher
-                            else:
-                                return temp + 5
-                    except:
-                        continue
-            return 0
-        except:
+        temp = self.sources.read('cpu_temperature')
+        if temp is None:
             return 0
+        # Convert millidegrees to degrees, add offset for GPU
+        if temp > 1000:
+            return (temp // 1000) + 5
+        else:
+            return temp + 5
     
     def read_intel_gpu_top_data(self):
         """Read Intel GPU utilization using intel_gpu_top"""
@@ -218,6 +189,7 @@ class RealIntelGPUMonitor:
         """Update data collections with real Intel GPU readings"""
         current_time = time.time() - self.start_time
         self.times.append(current_time)
+        self.sources.poll()
         
         # Get real Intel GPU data
         temperature = self.read_cpu_temperature()
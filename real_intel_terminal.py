@@ -8,8 +8,8 @@ import json
 import time
 import re
 import os
-import glob
 from collections import deque
+from gpu_sysfs_sources import SysfsSources, INTEL_GPU_FREQUENCY_PATTERNS, CPU_TEMPERATURE_PATTERNS
 
 class RealIntelTerminalMonitor:
     def __init__(self, max_points=20):
@@ -35,6 +35,11 @@ class RealIntelTerminalMonitor:
         # For interrupt rate calculation
         self.last_interrupt_count = 0
         self.last_interrupt_time = time.time()
+
+        # Resolve sysfs sources once; re-resolved on hotplug
+        self.sources = SysfsSources()
+        self.sources.add('gpu_frequency', INTEL_GPU_FREQUENCY_PATTERNS)
+        self.sources.add('cpu_temperature', CPU_TEMPERATURE_PATTERNS)
     
     def read_gpu_interrupt_rate(self):
         """Read Intel GPU interrupt rate from /proc/interrupts"""
@@ -77,49 +82,19 @@ class RealIntelTerminalMonitor:
 
     def read_intel_gpu_frequency(self):
         """Read actual Intel GPU frequency"""
-        try:
-            freq_paths = [
-                "/sys/class/drm/card*/gt/gt0/rps_cur_freq_mhz",
-                "/sys/class/drm/card*/gt_cur_freq_mhz", 
-                "/sys/class/drm/card*/device/gt_cur_freq_mhz"
-            ]
-            
-            for pattern in freq_paths:
-                files = glob.glob(pattern)
-                for file_path in files:
-                    try:
-                        with open(file_path, 'r') as f:
-                            freq = int(f.read().strip())
-                            return freq
-                    except:
-                        continue
-            return 0
-        except:
-            return 0
+        freq = self.sources.read('gpu_frequency')
+        return freq if freq is not None else 0
     
     def read_cpu_temperature(self):
         """Read CPU temperature as proxy for integrated GPU"""
-        try:
-            temp_paths = [
-                "/sys/class/hwmon/hwmon*/temp*_input",
-                "/sys/class/thermal/thermal_zone*/temp"
-            ]
-            
-            for pattern in temp_paths:
-                files = glob.glob(pattern)
-                for file_path in files:
-                    try:
-                        with open(file_path, 'r') as f:
-                            temp = int(f.read().strip())
-                            if temp > 1000:
-                                return (temp // 1000) + 3  # GPU estimate
-                            else:
-                                return temp + 3
-                    except:
-                        continue
-            return 0
-        except:
+        temp = self.sources.read('cpu_temperature')
+        if temp is None:
             return 0
+        # Convert millidegrees to degrees, add offset for GPU
+        if temp > 1000:
+            return (temp // 1000) + 3
+        else:
+            return temp + 3
     
     def read_intel_gpu_utilization(self):
         """Read Intel GPU utilization using intel_gpu_top"""
@@ -234,6 +209,7 @@ class RealIntelTerminalMonitor:
         self.clear_screen()
         
         # Read real data
+        self.sources.poll()
         temp = self.read_cpu_temperature()
         intel_data = self.read_intel_gpu_utilization()
         mem = self.read_system_memory_usage()
@@ -291,8 +267,8 @@ class RealIntelTerminalMonitor:
         
         # Data sources info
         print("📡 Data Sources:")
-        freq_source = "Available" if freq > 0 else "Not found"
-        temp_source = "Available" if temp > 0 else "Not found" 
+        freq_source = self.sources.path('gpu_frequency') or "Not found"
+        temp_source = self.sources.path('cpu_temperature') or "Not found"
         print(f"   • GPU Frequency: {freq_source}")
         print(f"   • Temperature: {temp_source}")
         print("   • GPU Utilization: intel_gpu_top")